@@ -21,6 +21,8 @@ birch::Driver::Driver(int argc, char** argv) :
     staticLib(false),
     sharedLib(true),
     openmp(true),
+    stdAtomic(true),
+    staticShapes(false),
     warnings(true),
     notes(false),
     verbose(true),
@@ -134,6 +136,10 @@ birch::Driver::Driver(int argc, char** argv) :
     DISABLE_SHARED_ARG,
     ENABLE_OPENMP_ARG,
     DISABLE_OPENMP_ARG,
+    ENABLE_STD_ATOMIC_ARG,
+    DISABLE_STD_ATOMIC_ARG,
+    ENABLE_STATIC_SHAPES_ARG,
+    DISABLE_STATIC_SHAPES_ARG,
     JOBS_ARG,
     ENABLE_WARNINGS_ARG,
     DISABLE_WARNINGS_ARG,
@@ -162,6 +168,10 @@ birch::Driver::Driver(int argc, char** argv) :
       { "disable-shared", no_argument, 0, DISABLE_SHARED_ARG },
       { "enable-openmp", no_argument, 0, ENABLE_OPENMP_ARG },
       { "disable-openmp", no_argument, 0, DISABLE_OPENMP_ARG },
+      { "enable-std-atomic", no_argument, 0, ENABLE_STD_ATOMIC_ARG },
+      { "disable-std-atomic", no_argument, 0, DISABLE_STD_ATOMIC_ARG },
+      { "enable-static-shapes", no_argument, 0, ENABLE_STATIC_SHAPES_ARG },
+      { "disable-static-shapes", no_argument, 0, DISABLE_STATIC_SHAPES_ARG },
       { "enable-warnings", no_argument, 0, ENABLE_WARNINGS_ARG },
       { "disable-warnings", no_argument, 0, DISABLE_WARNINGS_ARG },
       { "enable-notes", no_argument, 0, ENABLE_NOTES_ARG },
@@ -232,6 +242,18 @@ birch::Driver::Driver(int argc, char** argv) :
     case DISABLE_OPENMP_ARG:
       openmp = false;
       break;
+    case ENABLE_STD_ATOMIC_ARG:
+      stdAtomic = true;
+      break;
+    case DISABLE_STD_ATOMIC_ARG:
+      stdAtomic = false;
+      break;
+    case ENABLE_STATIC_SHAPES_ARG:
+      staticShapes = true;
+      break;
+    case DISABLE_STATIC_SHAPES_ARG:
+      staticShapes = false;
+      break;
     case ENABLE_WARNINGS_ARG:
       warnings = true;
       break;
@@ -272,6 +294,9 @@ birch::Driver::Driver(int argc, char** argv) :
   if (unit != "unity" && unit != "dir" && unit != "file") {
     throw DriverException("--unit must be unity, dir, or file.");
   }
+  if (!stdAtomic && openmp) {
+    throw DriverException("--disable-std-atomic requires --disable-openmp.");
+  }
 }
 
 void birch::Driver::run(const std::string& prog,
@@ -429,6 +454,16 @@ void birch::Driver::configure() {
     } else {
       options << " --disable-openmp";
     }
+    if (stdAtomic) {
+      options << " --enable-std-atomic";
+    } else {
+      options << " --disable-std-atomic";
+    }
+    if (staticShapes) {
+      options << " --enable-static-shapes";
+    } else {
+      options << " --disable-static-shapes";
+    }
     if (!prefix.empty()) {
       options << " --prefix=" << prefix;
     }
@@ -192,6 +192,16 @@ private:
    */
   bool openmp;
 
+  /**
+   * Use std::atomic for atomics, rather than OpenMP?
+   */
+  bool stdAtomic;
+
+  /**
+   * Use static shapes for arrays of fixed size?
+   */
+  bool staticShapes;
+
   /**
    * Enable compiler warnings?
    */
@@ -110,7 +110,8 @@ void birch::CppClassGenerator::visit(const Class* o) {
       out();
       finish(" {");
       in();
-      line("//");
+      genSourceLine(o->loc);
+      line("this->setAcyclic(libbirch::is_acyclic_class<this_type_>::value);");
       out();
       line("}\n");
     }
@@ -619,6 +619,7 @@ void birch::CppGenerator::visit(const For* o) {
   start("for (auto " << index << " = " << o->from << "; ");
   finish(index << " <= " << o->to << "; ++" << index << ") {");
   in();
+  line("libbirch::collect_if_due();");
   *this << o->braces->strip();
   out();
   line("}");
@@ -646,12 +647,14 @@ void birch::CppGenerator::visit(const Parallel* o) {
   line("}");
   out();
   line("}");
+  line("libbirch::merge_counts();");
 }
 
 void birch::CppGenerator::visit(const While* o) {
   genTraceLine(o->loc);
   line("while (" << o->cond->strip() << ") {");
   in();
+  line("libbirch::collect_if_due();");
   *this << o->braces->strip();
   out();
   line("}");
@@ -661,6 +664,7 @@ void birch::CppGenerator::visit(const DoWhile* o) {
   genTraceLine(o->loc);
   line("do {");
   in();
+  line("libbirch::collect_if_due();");
   *this << o->braces->strip();
   out();
   line("} while (" << o->cond->strip() << ");");
@@ -709,7 +713,15 @@ void birch::CppGenerator::visit(const EmptyType* o) {
 }
 
 void birch::CppGenerator::visit(const ArrayType* o) {
-  middle("libbirch::DefaultArray<" << o->single << ',' << o->depth() << '>');
+  if (o->lengths.empty()) {
+    middle("libbirch::DefaultArray<" << o->single << ',' << o->depth() << '>');
+  } else {
+    middle("libbirch::DeclaredArray<" << o->single);
+    for (auto length : o->lengths) {
+      middle(',' << length);
+    }
+    middle('>');
+  }
 }
 
 void birch::CppGenerator::visit(const TupleType* o) {
@@ -7,6 +7,7 @@
 #include "src/visitor/Gatherer.hpp"
 #include "src/primitive/poset.hpp"
 #include "src/primitive/inherits.hpp"
+#include "src/primitive/acyclic.hpp"
 #include "src/build/misc.hpp"
 
 birch::CppPackageGenerator::CppPackageGenerator(std::ostream& base,
@@ -83,6 +84,42 @@ void birch::CppPackageGenerator::visit(const Package* o) {
     }
     line("");
 
+    /* acyclicity of classes, as determined across the whole program, i.e.
+     * this package and its dependencies; these specializations must precede
+     * any use of is_acyclic_class, so are given straight after the forward
+     * declarations */
+    Gatherer<Class> allClasses;
+    for (auto file : o->files) {
+      file->accept(&allClasses);
+    }
+    acyclic analysis;
+    for (auto o : allClasses) {
+      analysis.insert(o);
+    }
+    std::list<std::pair<const Class*,bool>> acyclicClasses;
+    for (auto o : classes) {
+      auto result = analysis(o);
+      if (result != acyclic::UNKNOWN) {
+        acyclicClasses.push_back(std::make_pair(o, result == acyclic::ACYCLIC));
+      }
+    }
+    if (!acyclicClasses.empty()) {
+      line("}");
+      line("}\n");
+      line("namespace libbirch {");
+      for (auto pair : acyclicClasses) {
+        line("template<unsigned N>");
+        line("struct is_acyclic_class<birch::type::" << pair.first->name << ",N> {");
+        in();
+        line("static const bool value = " << (pair.second ? "true" : "false") << ';');
+        out();
+        line("};\n");
+      }
+      line("}\n");
+      line("namespace birch {");
+      line("namespace type {");
+    }
+
     /* basic type aliases */
     for (auto o : basics) {
       if (o->isAlias()) {
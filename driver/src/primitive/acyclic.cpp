@@ -0,0 +1,81 @@
+/**
+ * @file
+ */
+#include "src/primitive/acyclic.hpp"
+
+#include "src/visitor/Gatherer.hpp"
+
+void birch::acyclic::insert(const Class* o) {
+  classes.insert(std::make_pair(o->name->str(), o));
+}
+
+birch::acyclic::Result birch::acyclic::operator()(const Class* o) {
+  if (o->isAlias() || o->isGeneric()) {
+    return UNKNOWN;
+  }
+  auto iter = results.find(o);
+  if (iter != results.end()) {
+    return iter->second;
+  }
+
+  /* base class; a class without one derives from libbirch::Any, which is
+   * acyclic but for its label, which libbirch accounts for at run time */
+  auto result = ACYCLIC;
+  if (!o->base->isEmpty()) {
+    auto base = dynamic_cast<const NamedType*>(o->base);
+    auto baseClass = base ? classes.find(base->name->str()) : classes.end();
+    if (baseClass != classes.end() && base->typeArgs->isEmpty()) {
+      result = (*this)(baseClass->second);
+    } else {
+      result = UNKNOWN;
+    }
+  }
+
+  /* member variables */
+  Gatherer<MemberVariable> memberVariables;
+  o->accept(&memberVariables);
+  for (auto iter = memberVariables.begin(); iter != memberVariables.end() &&
+      result != CYCLIC; ++iter) {
+    result = join(result, (*this)((*iter)->type));
+  }
+
+  results.insert(std::make_pair(o, result));
+  return result;
+}
+
+birch::acyclic::Result birch::acyclic::operator()(const Type* o) {
+  if (auto type = dynamic_cast<const NamedType*>(o)) {
+    if (type->isClass()) {
+      return CYCLIC;
+    } else if (type->isBasic()) {
+      return ACYCLIC;
+    } else {
+      return UNKNOWN;
+    }
+  } else if (auto type = dynamic_cast<const ArrayType*>(o)) {
+    return (*this)(type->single);
+  } else if (auto type = dynamic_cast<const OptionalType*>(o)) {
+    return (*this)(type->single);
+  } else if (auto type = dynamic_cast<const TupleType*>(o)) {
+    return (*this)(type->single);
+  } else if (auto type = dynamic_cast<const TypeList*>(o)) {
+    return join((*this)(type->head), (*this)(type->tail));
+  } else if (dynamic_cast<const FunctionType*>(o) ||
+      dynamic_cast<const EmptyType*>(o)) {
+    /* function objects are not traversed by the cycle collector, so are
+     * values for its purposes, as in libbirch::is_acyclic */
+    return ACYCLIC;
+  } else {
+    return UNKNOWN;
+  }
+}
+
+birch::acyclic::Result birch::acyclic::join(const Result a, const Result b) {
+  if (a == CYCLIC || b == CYCLIC) {
+    return CYCLIC;
+  } else if (a == UNKNOWN || b == UNKNOWN) {
+    return UNKNOWN;
+  } else {
+    return ACYCLIC;
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file
+ */
+#pragma once
+
+namespace birch {
+class Class;
+class Type;
+
+/**
+ * Whole-program analysis of which classes are acyclic, in the sense of
+ * `libbirch::is_acyclic_class`, so that an object of the class can never
+ * take part in a reference cycle.
+ *
+ * A class is acyclic if all of its member variables, including inherited
+ * ones, are of value type. A member variable of class type is never
+ * acyclic, even if the class is final and itself acyclic: the object that
+ * it points to may be a copy, and so be linked back into a cycle through
+ * the memo of its label. Classes that cannot be resolved, e.g. generic
+ * classes, or those with a generic base, are left unknown, for libbirch to
+ * decide when compiling the generated code.
+ */
+class acyclic {
+public:
+  /**
+   * Result of the analysis.
+   */
+  enum Result {
+    UNKNOWN,
+    ACYCLIC,
+    CYCLIC
+  };
+
+  /**
+   * Make a class declaration visible to the analysis. All classes of the
+   * package and of its dependencies should be inserted before any query, so
+   * that base classes can be resolved.
+   */
+  void insert(const Class* o);
+
+  /**
+   * Is a class acyclic?
+   */
+  Result operator()(const Class* o);
+
+  /**
+   * Is a type acyclic?
+   */
+  Result operator()(const Type* o);
+
+private:
+  /**
+   * Combine two results: cyclic if either is, otherwise unknown if either
+   * is, otherwise acyclic.
+   */
+  static Result join(const Result a, const Result b);
+
+  /**
+   * Classes by name.
+   */
+  std::unordered_map<std::string,const Class*> classes;
+
+  /**
+   * Results by class.
+   */
+  std::unordered_map<const Class*,Result> results;
+};
+}
@@ -42,5 +42,11 @@ public:
    * Number of dimensions.
    */
   int ndims;
+
+  /**
+   * Static lengths of the dimensions, if known, otherwise empty. These are
+   * set for variables declared with positive integer literals as lengths.
+   */
+  std::vector<int64_t> lengths;
 };
 }
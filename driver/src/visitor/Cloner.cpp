@@ -290,7 +290,9 @@ birch::Type* birch::Cloner::clone(const MemberType* o) {
 }
 
 birch::Type* birch::Cloner::clone(const ArrayType* o) {
-  return new ArrayType(o->single->accept(this), o->ndims, o->loc);
+  auto result = new ArrayType(o->single->accept(this), o->ndims, o->loc);
+  result->lengths = o->lengths;
+  return result;
 }
 
 birch::Type* birch::Cloner::clone(const TupleType* o) {
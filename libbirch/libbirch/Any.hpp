@@ -6,6 +6,7 @@
 #include "libbirch/external.hpp"
 #include "libbirch/assert.hpp"
 #include "libbirch/memory.hpp"
+#include "libbirch/profile.hpp"
 #include "libbirch/Atomic.hpp"
 #include "libbirch/Init.hpp"
 #include "libbirch/LabelPtr.hpp"
@@ -34,11 +35,12 @@ public:
    */
   Any() :
       label(root()),
-      sharedCount(0u),
+      sharedCount(0),
       memoCount(1u),
+      biasedCount(0),
       size(0u),
       tid(get_thread_num()),
-      flags(0u) {
+      flags(memory_stats ? COUNTED : 0u) {
     //
   }
 
@@ -47,11 +49,12 @@ public:
    */
   Any(int) :
       label(nullptr),
-      sharedCount(0u),
+      sharedCount(0),
       memoCount(1u),
+      biasedCount(0),
       size(0u),
       tid(0),
-      flags(0u) {
+      flags(memory_stats ? COUNTED : 0u) {
     //
   }
 
@@ -66,7 +69,7 @@ public:
    * Destructor.
    */
   virtual ~Any() {
-    assert(sharedCount.load() == 0u);
+    assert(numShared() == 0u);
   }
 
   /**
@@ -96,6 +99,7 @@ public:
    */
   void finish(Label* label) {
     if (!(flags.exchangeOr(FINISHED) & FINISHED)) {
+      profile_count(COUNT_FINISHED);
       finish_(label);
     }
   }
@@ -106,7 +110,8 @@ public:
   void freeze() {
     libbirch_assert_(isFinished());
     if (!(flags.exchangeOr(FROZEN) & FROZEN)) {
-      if (sharedCount.load() == 1u) {
+      profile_count(COUNT_FROZEN);
+      if (numShared() == 1u) {
         // ^ small optimization: isUnique() makes sense, but unnecessarily
         //   loads memoCount as well, which is unnecessary for a objects
         //   that are not frozen
@@ -116,13 +121,6 @@ public:
     }
   }
 
-  /**
-   * Thaw the object.
-   */
-  void thaw() {
-    flags.maskAnd(~BUFFERED);
-  }
-
   /**
    * Copy the object.
    *
@@ -131,11 +129,12 @@ public:
   Any* copy(Label* label) {
     auto o = copy_(label);
     new (&o->label) decltype(o->label)(label);
-    o->sharedCount.store(0u);
-    o->memoCount.store(1u);
+    o->sharedCount.store(0, std::memory_order_relaxed);
+    o->memoCount.store(1u, std::memory_order_relaxed);
+    o->biasedCount.store(0, std::memory_order_relaxed);
     o->size = 0u;
     o->tid = get_thread_num();
-    o->flags.store(0u);
+    o->flags.store(memory_stats ? COUNTED : 0u, std::memory_order_relaxed);
     return o;
   }
 
@@ -149,7 +148,8 @@ public:
    */
   void recycle(Label* label) {
     this->label.replace(label);
-    this->flags.maskAnd(~(FINISHED|FROZEN|FROZEN_UNIQUE));
+    this->flags.maskAnd(~(FINISHED|FROZEN|FROZEN_UNIQUE|ACYCLIC|SURVIVED|
+        TENURED));
     recycle_(label);
   }
 
@@ -162,8 +162,7 @@ public:
   void mark() {
     if (!(flags.exchangeOr(MARKED) & MARKED)) {
       flags.maskAnd(~(POSSIBLE_ROOT|BUFFERED|SCANNED|REACHED|COLLECTED));
-      label.mark();
-      mark_();
+      visitOrRegister(MARK_MEMBERS);
     }
   }
 
@@ -178,12 +177,11 @@ public:
       flags.maskAnd(~MARKED);  // unset for next time
       if (numShared() > 0u) {
         if (!(flags.exchangeOr(REACHED) & REACHED)) {
-          label.reach();
-          reach_();
+          survive();
+          visitOrRegister(REACH_MEMBERS);
         }
       } else {
-        label.scan();
-        scan_();
+        visitOrRegister(SCAN_MEMBERS);
       }
     }
   }
@@ -199,8 +197,8 @@ public:
       flags.maskAnd(~MARKED);  // unset for next time
     }
     if (!(flags.exchangeOr(REACHED) & REACHED)) {
-      label.reach();
-      reach_();
+      survive();
+      visitOrRegister(REACH_MEMBERS);
     }
   }
 
@@ -214,8 +212,80 @@ public:
     auto old = flags.exchangeOr(COLLECTED);
     if (!(old & COLLECTED) && !(old & REACHED)) {
       register_unreachable(this);
+      visitOrRegister(COLLECT_MEMBERS);
+    }
+  }
+
+  /**
+   * Note that the object has survived a cycle collection, having been found
+   * reachable. If generational collection is enabled, a frozen object that
+   * does so twice is registered for promotion to the old generation.
+   */
+  void survive() {
+    if (collect_generational &&
+        (flags.load(std::memory_order_relaxed) & (FROZEN|TENURED)) == FROZEN &&
+        (flags.exchangeOr(SURVIVED) & SURVIVED)) {
+      register_tenured(this);
+    }
+  }
+
+  /**
+   * Promote the object to the old generation.
+   */
+  void tenure() {
+    flags.maskOr(TENURED);
+  }
+
+  /**
+   * Is the object to be skipped by the current cycle collection? This is
+   * the case for objects in the old generation during a minor collection.
+   * Such an object is treated as reachable: references to it are neither
+   * broken nor restored, and its members are not visited.
+   */
+  bool isSkipped() const {
+    return collect_minor && (flags.load(std::memory_order_relaxed) & TENURED);
+  }
+
+  /**
+   * Visit the members of the object for an operation of the cycle
+   * collector. The operations above perform this immediately, or, when
+   * other threads are out of work, defer it via register_visit(), so that
+   * it may be stolen.
+   *
+   * @param visit The operation.
+   */
+  void visit(const Visit visit) {
+    switch (visit) {
+    case MARK_MEMBERS:
+      label.mark();
+      mark_();
+      break;
+    case SCAN_MEMBERS:
+      label.scan();
+      scan_();
+      break;
+    case REACH_MEMBERS:
+      label.reach();
+      reach_();
+      break;
+    case COLLECT_MEMBERS:
       label.collect();
       collect_();
+      break;
+    }
+  }
+
+  /**
+   * Visit the members of the object immediately, or register the visit with
+   * the cycle collector if other threads are out of work.
+   *
+   * @param visit The operation.
+   */
+  void visitOrRegister(const Visit visit) {
+    if (hungry.load(std::memory_order_relaxed)) {
+      register_visit(this, visit);
+    } else {
+      this->visit(visit);
     }
   }
 
@@ -223,9 +293,13 @@ public:
    * Destroy, but do not deallocate, the object.
    */
   void destroy() {
-    assert(sharedCount.load() == 0u);
+    assert(numShared() == 0u);
     this->flags.maskOr(DESTROYED);
     this->size = size_();
+    if (flags.load(std::memory_order_relaxed) & COUNTED) {
+      count_object(getClassName(), -1);
+    }
+    profile_count(COUNT_DESTROYED);
     this->~Any();
   }
 
@@ -233,7 +307,8 @@ public:
    * Shared count.
    */
   unsigned numShared() const {
-    return sharedCount.load();
+    return biasedCount.load(std::memory_order_relaxed) +
+        (sharedCount.load() & ~MERGED)/SHARED_UNIT;
   }
 
   /**
@@ -246,7 +321,14 @@ public:
     //   a performance issue, and as long as one thread can reach the object
     //   it is fine to be off
     // ^ disabling this option improves performance on several examples
-    sharedCount.increment();
+    if (isBiased()) {
+      biasedCount.store(biasedCount.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+    } else {
+      sharedCount.exchangeAdd(SHARED_UNIT, std::memory_order_relaxed);
+      // ^ a new reference can only be made from an existing one, so no
+      //   ordering is required
+    }
   }
 
   /**
@@ -258,46 +340,52 @@ public:
     assert(numShared() > 0u);
 
     /* if the count will reduce to nonzero, this is possibly the root of
-     * a cycle */
+     * a cycle, unless the object is of an acyclic class */
     if (numShared() > 1u &&
-        !(flags.exchangeOr(BUFFERED|POSSIBLE_ROOT) & BUFFERED)) {
+        !(flags.load(std::memory_order_relaxed) & ACYCLIC) &&
+        !(flags.exchangeOr(BUFFERED|POSSIBLE_ROOT,
+        std::memory_order_acq_rel) & BUFFERED)) {
       register_possible_root(this);
     }
 
     /* decrement */
-    if (--sharedCount == 0u) {
+    if (decCount()) {
       destroy();
       decMemo();
     }
   }
 
   /**
-   * Decrement the shared count with a known acyclic referent. This decrements
-   * the count, and if the new count is zero, it destroys the object. The
-   * caller asserts that the object is of acyclic type (@see is_acyclic), so
-   * that there is no need to register the object as a possible root for cycle
-   * collection.
+   * Decrement the shared count for an object that will remain reachable. The
+   * caller asserts that the object will remain reachable after the operation.
+   * The object will not be destroyed, and will not be registered as a
+   * possible root for cycle collection.
    *
-   * Acyclic objects occur in @ref Bacon2001 "Bacon & Rajan (2001)", where
-   * they are colored *green*.
+   * During cycle collection, this may leave the biased count zero or
+   * negative without merging it, as the reference is restored, possibly by a
+   * different thread, in reach().
    */
-  void decSharedAcyclic() {
+  void decSharedReachable() {
     assert(numShared() > 0u);
-    if (--sharedCount == 0u) {
-      destroy();
-      decMemo();
+    if (isBiased()) {
+      biasedCount.store(biasedCount.load(std::memory_order_relaxed) - 1,
+          std::memory_order_relaxed);
+    } else {
+      sharedCount.exchangeSub(SHARED_UNIT, std::memory_order_release);
     }
   }
 
   /**
-   * Decrement the shared count for an object that will remain reachable. The
-   * caller asserts that the object will remain reachable after the operation.
-   * The object will not be destroyed, and will not be registered as a
-   * possible root for cycle collection.
+   * Merge the biased count into the shared count, and destroy the object if
+   * the total is zero. This is called by the owning thread, for objects
+   * registered with register_merge() by other threads.
    */
-  void decSharedReachable() {
-    assert(numShared() > 0u);
-    sharedCount.decrement();
+  void merge() {
+    if (!(sharedCount.load(std::memory_order_relaxed) & MERGED) &&
+        mergeCount() == 0) {
+      destroy();
+      decMemo();
+    }
   }
 
   /**
@@ -311,7 +399,7 @@ public:
    * Increment the memo count.
    */
   void incMemo() {
-    memoCount.increment();
+    memoCount.increment(std::memory_order_relaxed);
   }
 
   /**
@@ -319,7 +407,7 @@ public:
    */
   void decMemo() {
     assert(memoCount.load() > 0u);
-    if (--memoCount == 0u) {
+    if (memoCount.exchangeSub(1u, std::memory_order_acq_rel) == 1u) {
       assert(numShared() == 0u);
       deallocate();
     }
@@ -376,12 +464,130 @@ public:
     return flags.load() & FROZEN_UNIQUE;
   }
 
+  /**
+   * Is the object of an acyclic class?
+   */
+  bool isAcyclic() const {
+    return flags.load(std::memory_order_relaxed) & ACYCLIC;
+  }
+
+  /**
+   * Set whether the object is of an acyclic class (@see is_acyclic_class).
+   * The constructor of each class calls this, so that the constructor of
+   * the most-derived class decides.
+   *
+   * @param acyclic Is the class acyclic?
+   *
+   * An object of an acyclic class may still be linked into a cycle through
+   * its label, via the memo of that label, unless that is the root label,
+   * which is not reference counted. A new object has the root label, but a
+   * copy does not, so copy() and recycle() clear the flag again. While the
+   * flag is set, the object is never registered as a possible root for
+   * cycle collection.
+   *
+   * As the object is under construction, and not yet visible to other
+   * threads, this uses a plain load and store of the flags rather than an
+   * atomic read-modify-write.
+   *
+   * Acyclic objects occur in @ref Bacon2001 "Bacon & Rajan (2001)", where
+   * they are colored *green*.
+   */
+  void setAcyclic(const bool acyclic) {
+    assert(!acyclic || label.get() == root());
+    auto f = flags.load(std::memory_order_relaxed);
+    flags.store(uint16_t(acyclic ? f|ACYCLIC : f & ~ACYCLIC),
+        std::memory_order_relaxed);
+  }
+
 private:
+  /**
+   * Are updates to the count of the object by the current thread biased?
+   * They are if the current thread is the owning thread, and the biased
+   * count has not yet been merged.
+   */
+  bool isBiased() const {
+    return tid == get_thread_num() &&
+        !(sharedCount.load(std::memory_order_relaxed) & MERGED);
+  }
+
+  /**
+   * Is the owning thread idle, so that the current thread may merge the
+   * biased count in its place? It is if the owning thread is a thread of
+   * the OpenMP team other than the master, and the current thread is the
+   * master outside of any parallel region. The owning thread last updated
+   * the biased count before the barrier at the end of the previous parallel
+   * region, and does not run again until the next.
+   */
+  bool isOwnerIdle() const {
+    return tid > 0 && tid < get_max_threads() && !in_parallel() &&
+        get_thread_num() == 0;
+  }
+
+  /**
+   * Decrement the count.
+   *
+   * @return Has the count reached zero, so that the object should be
+   * destroyed?
+   *
+   * The owning thread decrements the biased count. If this reaches zero (or
+   * below, where references made by other threads are released by the
+   * owning thread) it merges the biased count into the shared count. Other
+   * threads decrement the shared count. If the biased count has been merged,
+   * this is the total count, and so is checked for zero; otherwise, if it
+   * reaches zero or below, the total count may be zero. The count is then
+   * merged immediately if the owning thread is idle (see isOwnerIdle()),
+   * as for objects created in a parallel region and released by the master
+   * after it; otherwise the object is registered with the owning thread to
+   * merge its count at the next cycle collection.
+   *
+   * The merge sets the *merged* bit and adds the biased count to the shared
+   * count in a single read-modify-write operation on the shared count word,
+   * and other threads see the bit in the result of their own subtraction
+   * from the same word. The operations are totally ordered, and exactly one
+   * of them brings the word to *merged* with a count of zero, which is the
+   * one that destroys the object.
+   */
+  bool decCount() {
+    if (isBiased()) {
+      auto count = biasedCount.load(std::memory_order_relaxed) - 1;
+      biasedCount.store(count, std::memory_order_relaxed);
+      return count <= 0 && mergeCount() == 0;
+    } else {
+      auto word = sharedCount.exchangeSub(SHARED_UNIT,
+          std::memory_order_acq_rel) - SHARED_UNIT;
+      if (word & MERGED) {
+        return word == MERGED;
+      } else {
+        if (word <= 0 && !(flags.exchangeOr(QUEUED) & QUEUED)) {
+          if (isOwnerIdle()) {
+            return mergeCount() == 0;
+          }
+          register_merge(this, tid);
+        }
+        return false;
+      }
+    }
+  }
+
+  /**
+   * Merge the biased count into the shared count. This must be called by the
+   * owning thread, and only once.
+   *
+   * @return The total count after merging.
+   */
+  int mergeCount() {
+    auto count = biasedCount.load(std::memory_order_relaxed);
+    biasedCount.store(0, std::memory_order_relaxed);
+    auto add = count*SHARED_UNIT + MERGED;
+    auto word = sharedCount.exchangeAdd(add, std::memory_order_acq_rel) + add;
+    return (word & ~MERGED)/SHARED_UNIT;
+  }
+
   /**
    * Deallocate the object. It should have previously been destroyed.
    */
   void deallocate() {
-    assert(sharedCount.load() == 0u);
+    assert(numShared() == 0u);
     assert(memoCount.load() == 0u);
     libbirch::deallocate(this, size, tid);
   }
@@ -392,15 +598,33 @@ private:
   LabelPtr label;
 
   /**
-   * Shared count.
+   * Shared count word, updated by threads other than the owning thread. The
+   * least significant bit is the *merged* bit, set once the biased count has
+   * been merged into the shared count; the remaining bits are the shared
+   * count, in units of SHARED_UNIT. Keeping both in the one word means that
+   * a merge and a concurrent decrement cannot both see the total reach zero.
+   * The count may be negative, where references counted in the biased count
+   * are released by other threads.
    */
-  Atomic<unsigned> sharedCount;
+  Atomic<int> sharedCount;
 
   /**
    * Memo count, or, if the shared count is nonzero, one plus the memo count.
    */
   Atomic<unsigned> memoCount;
 
+  /**
+   * Biased count, updated by the owning thread only (that given by `tid`),
+   * without read-modify-write operations. The shared count of the object is
+   * the sum of the biased count and shared count. This is the biased
+   * reference counting of @ref Choi2018 "Choi, Shull & Torrellas (2018)":
+   * most objects are only ever used by the thread that created them, which
+   * then avoids atomic operations altogether. The biased count is merged into
+   * the shared count once it reaches zero, after which all threads, including
+   * the owning thread, update the shared count only.
+   */
+  Atomic<int> biasedCount;
+
   /**
    * Size of the object. This is initially set to zero. Upon destruction, it
    * is set to the correct size with a virtual function call.
@@ -452,6 +676,22 @@ private:
    *     *white* (first on, second off),
    *   - *collected* is set once a white object has been destroyed.
    *
+   * Alongside these, *buffered* is set while the object is in a list of
+   * possible roots, so that it is never registered in more than one entry.
+   * For generational collection, *survived* is set once a frozen object has
+   * been found reachable by a collection, and *tenured* once it has been so
+   * twice, promoting it to the old generation, which only full collections
+   * traverse (see set_collect_generational()).
+   *
+   * Finally, *destroyed* is set once the object has been destroyed, while
+   * *queued* is used for biased reference counting, set once the object has
+   * been registered with the owning thread to merge its biased count (the
+   * *merged* bit itself is kept in the shared count word; see sharedCount).
+   * Lastly, *acyclic* is set for objects of an acyclic class, which
+   * are never registered as possible roots, and *counted* for objects that
+   * were counted in the per-class statistics when allocated, so that only
+   * those are uncounted when destroyed (see enable_memory_stats()).
+   *
    * The use of these flags also resolves some thread safety issues that can
    * otherwise exist during the scan operation, when coloring an object white
    * (eligible for collection) then later recoloring it black (reachable); the
@@ -472,7 +712,20 @@ private:
     SCANNED = (1u << 6u),
     REACHED = (1u << 7u),
     COLLECTED = (1u << 8u),
-    DESTROYED = (1u << 9u)
+    DESTROYED = (1u << 9u),
+    QUEUED = (1u << 10u),
+    ACYCLIC = (1u << 11u),
+    SURVIVED = (1u << 12u),
+    TENURED = (1u << 13u),
+    COUNTED = (1u << 14u)
+  };
+
+  /**
+   * Constants for the shared count word (see sharedCount).
+   */
+  enum SharedWord : int {
+    MERGED = 1,
+    SHARED_UNIT = 2
   };
 
 public:
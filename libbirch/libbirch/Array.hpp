@@ -18,6 +18,13 @@ namespace libbirch {
  *
  * @tparam T Value type.
  * @tparam F Shape type.
+ *
+ * The elements of an array are usually stored in a Buffer, which is shared
+ * between copies of the array with copy-on-write semantics. Small arrays of
+ * arithmetic type, such as the short vectors and matrices of
+ * state-space models, are instead stored inline, in the array itself, see
+ * SMALL_BYTES. These are copied immediately, which for so few elements is
+ * cheaper than the allocation and atomic use count of a buffer.
  */
 template<class T, class F>
 class Array {
@@ -35,9 +42,13 @@ public:
   Array() :
       shape(),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
-    assert(shape.volume() == 0);
+    /* a static shape has nonzero volume by default */
+    allocate();
+    if (!is_value<T>::value) {
+      initialize();
+    }
   }
 
   /**
@@ -49,7 +60,7 @@ public:
   Array(const F& shape) :
       shape(shape),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
   }
@@ -63,7 +74,7 @@ public:
   Array(const F& shape) :
       shape(shape),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     initialize();
@@ -81,7 +92,7 @@ public:
   Array(const F& shape, Args ... args) :
       shape(shape),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     initialize(args...);
@@ -97,7 +108,7 @@ public:
   Array(const std::initializer_list<T>& values) :
       shape(values.size()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     std::uninitialized_copy(values.begin(), values.end(), begin());
@@ -113,7 +124,7 @@ public:
   Array(const std::initializer_list<std::initializer_list<T>>& values) :
       shape(values.size(), values.begin()->size()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     auto ptr = buf();
@@ -134,7 +145,7 @@ public:
   Array(const L& l, const F& shape) :
       shape(shape),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     int64_t n = 0;
@@ -148,35 +159,42 @@ public:
    */
   Array(const Array<T,F>& o) :
       shape(o.shape),
-      buffer(o.buffer),
-      offset(o.offset),
+      buffer(nullptr),
+      ptr(nullptr),
       isView(false) {
-    if (o.buffer) {
-      if (!o.isView && is_value<T>::value) {
-        /* copy on write for non-views of value types */
-        buffer->incUsage();
-      } else {
-        /* immediate copy for others */
-        buffer = nullptr;
-        offset = 0;
-        allocate();
-        uninitialized_copy(o);
-      }
+    if (o.buffer && !o.isView && is_value<T>::value) {
+      /* copy on write for non-views of value types */
+      buffer = o.buffer;
+      buffer->incUsage();
+    } else if (o.volume() > 0) {
+      /* immediate copy for others, including small arrays; an empty view
+       * takes nothing from the buffer of its array */
+      allocate();
+      uninitialized_copy(o);
     }
   }
 
   /**
-   * Generic copy constructor.
+   * Generic copy constructor. Where only the shape type differs, e.g. when
+   * a static array is passed as a dynamic one, this uses the same
+   * copy-on-write facility as the copy constructor.
    */
   template<class U, class G, std::enable_if_t<F::count() == G::count() &&
       std::is_convertible<U,T>::value,int> = 0>
   Array(const Array<U,G>& o) :
       shape(o.shape.compact()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
-    allocate();
-    uninitialized_copy(o);
+    if (std::is_same<U,T>::value && o.buffer && !o.isView &&
+        is_value<T>::value) {
+      /* the storage of a non-view is compact, whatever its shape type */
+      buffer = reinterpret_cast<Buffer<T>*>(o.buffer);
+      buffer->incUsage();
+    } else {
+      allocate();
+      uninitialized_copy(o);
+    }
   }
 
   /**
@@ -200,7 +218,6 @@ public:
         assert(bytes > 0u);
 	      void* src = buf();
         buffer = new (libbirch::allocate(bytes)) Buffer<T>();
-        offset = 0;
         void* dst = buf();
         std::memcpy(dst, src, sizeof(T)*volume());
       }
@@ -280,7 +297,7 @@ public:
   template<class V, class U, std::enable_if_t<V::rangeCount() != 0,int> = 0>
   auto set(const V& slice, const U& value) {
     pinWrite();
-    Array<T,decltype(shape(slice))> o(shape(slice), buffer, offset +
+    Array<T,decltype(shape(slice))> o(shape(slice), buffer, buf() +
         shape.serial(slice));
     o = value;
     unpin();
@@ -297,7 +314,7 @@ public:
 
   template<class V, std::enable_if_t<V::rangeCount() != 0,int> = 0>
   auto get(const V& slice) const {
-    return Array<T,decltype(shape(slice))>(shape(slice), buffer, offset +
+    return Array<T,decltype(shape(slice))>(shape(slice), buffer, buf() +
         shape.serial(slice));
   }
 
@@ -347,12 +364,12 @@ public:
   auto operator()(const V& slice) {
     assert(!isShared());
     return Array<T,decltype(shape(slice))>(shape(slice),
-        buffer, offset + shape.serial(slice));
+        buffer, buf() + shape.serial(slice));
   }
   template<class V, std::enable_if_t<V::rangeCount() != 0,int> = 0>
   auto operator()(const V& slice) const {
     return Array<T,decltype(shape(slice))>(shape(slice),
-        buffer, offset + shape.serial(slice));
+        buffer, buf() + shape.serial(slice));
   }
   template<class V, std::enable_if_t<V::rangeCount() == 0,int> = 0>
   value_type& operator()(const V& slice) {
@@ -492,10 +509,12 @@ public:
         buf()[j].~T();
       }
       std::memmove((void*)(buf() + i), (void*)(buf() + i + len), (n - len - i)*sizeof(T));
-      auto oldBytes = Buffer<T>::size(shape.volume());
-      auto newBytes = Buffer<T>::size(s.volume());
-      buffer = (Buffer<T>*)libbirch::reallocate(buffer, oldBytes,
-          buffer->tid, newBytes);
+      if (buffer) {
+        auto oldBytes = Buffer<T>::size(shape.volume());
+        auto newBytes = Buffer<T>::size(s.volume());
+        buffer = (Buffer<T>*)libbirch::reallocate(buffer, oldBytes,
+            buffer->tid, newBytes);
+      }
     }
     shape = s;
     unlock();
@@ -523,6 +542,27 @@ public:
         colStride()));
   }
 
+  /**
+   * As toEigen(), but mapped without strides. Eigen can vectorize
+   * operations on the result, which it cannot do for toEigen(), as the
+   * strides there are only known at run time. The array must be contiguous,
+   * as is always the case for an array that is not a view; a copy of a view
+   * is contiguous.
+   */
+  template<IS_VALUE(T)>
+  auto toEigenContiguous() {
+    assert(isContiguous());
+    return Eigen::Map<typename eigen_type::PlainObject>(buf(), rows(),
+        cols());
+  }
+
+  template<IS_VALUE(T)>
+  auto toEigenContiguous() const {
+    assert(isContiguous());
+    return Eigen::Map<const typename eigen_type::PlainObject>(buf(), rows(),
+        cols());
+  }
+
   /**
    * Construct from Eigen Matrix expression.
    */
@@ -530,10 +570,10 @@ public:
   Array(const Eigen::MatrixBase<EigenType>& o) :
       shape(o.rows(), o.cols()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
-    toEigen() = o;
+    toEigenContiguous() = o;
   }
 
   /**
@@ -543,7 +583,7 @@ public:
   Array(const Eigen::DiagonalWrapper<EigenType>& o) :
       shape(o.rows(), o.cols()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     toEigen() = o;
@@ -556,7 +596,7 @@ public:
   Array(const Eigen::TriangularView<EigenType,Mode>& o)  :
       shape(o.rows(), o.cols()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     toEigen() = o;
@@ -593,6 +633,15 @@ public:
     assert(1 <= F::count() && F::count() <= 2);
     return F::count() == 1 ? shape.stride(0) : shape.stride(1);
   }
+
+  /**
+   * Are the elements contiguous in storage, in row-major order?
+   */
+  bool isContiguous() const {
+    assert(1 <= F::count() && F::count() <= 2);
+    return size() == 0 || (colStride() == 1 &&
+        (F::count() == 1 || rowStride() == cols()));
+  }
   ///@}
 
 private:
@@ -603,7 +652,7 @@ private:
   Array(const F& shape, const Array<U,G>& o) :
       shape(shape.compact()),
       buffer(nullptr),
-      offset(0),
+      ptr(nullptr),
       isView(false) {
     allocate();
     uninitialized_copy(o);
@@ -611,20 +660,39 @@ private:
 
   /**
    * Constructor for views.
+   *
+   * @param shape Shape.
+   * @param buffer Buffer of the array being viewed, or null if its
+   * elements are stored inline.
+   * @param ptr First element of the view.
    */
-  Array(const F& shape, Buffer<T>* buffer, int64_t offset) :
+  Array(const F& shape, Buffer<T>* buffer, T* ptr) :
       shape(shape),
       buffer(buffer),
-      offset(offset),
+      ptr(ptr),
       isView(true) {
     //
   }
 
+  /**
+   * Can an array of @p n elements be stored inline?
+   */
+  static constexpr bool isSmall(const int64_t n) {
+    return std::is_arithmetic<T>::value &&
+        int64_t(sizeof(T))*n <= int64_t(SMALL_BYTES);
+  }
+
   /**
    * Raw pointer to underlying buffer.
    */
   T* buf() const {
-    return buffer->buf() + offset;
+    if (isView) {
+      return ptr;
+    } else if (buffer) {
+      return buffer->buf();
+    } else {
+      return reinterpret_cast<T*>(const_cast<small_type*>(small));
+    }
   }
 
   /**
@@ -642,7 +710,9 @@ private:
     assert(!o.isView);
     std::swap(buffer, o.buffer);
     std::swap(shape, o.shape);
-    std::swap(offset, o.offset);
+    if (isSmall(1)) {
+      std::swap(small, o.small);
+    }
   }
 
   /**
@@ -650,10 +720,12 @@ private:
    */
   void allocate() {
     assert(!buffer);
-    auto bytes = Buffer<T>::size(volume());
-    if (bytes > 0u) {
-      buffer = new (libbirch::allocate(bytes)) Buffer<T>();
-      offset = 0;
+    auto n = volume();
+    if (!isSmall(n)) {
+      auto bytes = Buffer<T>::size(n);
+      if (bytes > 0u) {
+        buffer = new (libbirch::allocate(bytes)) Buffer<T>();
+      }
     }
   }
 
@@ -674,7 +746,7 @@ private:
       libbirch::deallocate(buffer, bytes, buffer->tid);
     }
     buffer = nullptr;
-    offset = 0;
+    ptr = nullptr;
   }
 
   /**
@@ -729,14 +801,17 @@ private:
   F shape;
 
   /**
-   * Buffer.
+   * Buffer. This is null for an empty array, and for a small array, the
+   * elements of which are stored inline in `small`.
    */
   Buffer<T>* buffer;
 
   /**
-   * Offset into the buffer. This should be zero when isView is false.
+   * For a view, the first element, which lies in the buffer or small
+   * storage of the array being viewed. This should be null when isView is
+   * false.
    */
-  int64_t offset;
+  T* ptr;
 
   /**
    * Is this a view of another array? A view has stricter assignment
@@ -750,6 +825,24 @@ private:
    * is obtained to substitute the current buffer with another.
    */
   ReadersWriterLock bufferLock;
+
+  /**
+   * Maximum number of bytes of elements stored inline, see isSmall().
+   * This is enough for a vector of four, or a 2x2 matrix, of `Real`.
+   */
+  static constexpr size_t SMALL_BYTES = 32u;
+
+  /**
+   * Element type of inline storage. For types that are never stored
+   * inline, this is a placeholder.
+   */
+  using small_type = std::conditional_t<std::is_arithmetic<T>::value,T,char>;
+
+  /**
+   * Inline storage for the elements of a small array.
+   */
+  small_type small[std::is_arithmetic<T>::value ?
+      SMALL_BYTES/sizeof(small_type) : 1u];
 };
 
 template<class T, class F>
@@ -768,4 +861,36 @@ struct is_acyclic<Array<T,F>,N> {
 template<class T, int D>
 using DefaultArray = Array<T,typename DefaultShape<D>::type>;
 
+/**
+ * Array with the given static lengths, see StaticShape.
+ */
+template<class T, int64_t... lengths>
+using StaticArray = Array<T,typename StaticShape<lengths...>::type>;
+
+/**
+ * @def LIBBIRCH_STATIC_SHAPES
+ *
+ * Set to true for arrays declared with static lengths to have static shapes,
+ * see DeclaredArray. This is set at configure time with
+ * `--enable-static-shapes`; the same choice must be made when configuring a
+ * package and the packages and programs that use it, as it changes the
+ * types of their member variables.
+ */
+#ifndef LIBBIRCH_STATIC_SHAPES
+#define LIBBIRCH_STATIC_SHAPES 0
+#endif
+
+/**
+ * Array for a variable declared with the given static lengths. This is
+ * StaticArray if LIBBIRCH_STATIC_SHAPES is set, otherwise DefaultArray with
+ * the same number of dimensions.
+ */
+#if LIBBIRCH_STATIC_SHAPES
+template<class T, int64_t... lengths>
+using DeclaredArray = StaticArray<T,lengths...>;
+#else
+template<class T, int64_t... lengths>
+using DeclaredArray = DefaultArray<T,sizeof...(lengths)>;
+#endif
+
 }
@@ -16,13 +16,25 @@
  * compare-and-swap/compare-and-exchange, only swap/exchange, which requires
  * some clunkier client code, especially for read-write locks.
  *
- * The alternative implementation use std::atomic.
+ * The alternative implementation use std::atomic. Its operations take an
+ * optional memory order, which defaults to sequential consistency, so that
+ * callers may relax the ordering where it is safe to do so; e.g. reference
+ * count increments need no ordering, and decrements only acquire-release.
+ * The OpenMP implementation ignores the memory order, and always uses
+ * sequential consistency.
+ *
+ * The OpenMP implementation may be selected at configure time with
+ * `--disable-std-atomic`, which defines LIBBIRCH_ATOMIC_OPENMP; the same
+ * choice must be made when configuring LibBirch and programs that use it.
+ * As its compareExchange() is not atomic with respect to other operations,
+ * configure rejects `--disable-std-atomic` unless OpenMP is also disabled.
  *
  * Atomic provides the default constructor, copy and move constructors, copy
  * and move assignment operators, in order to be trivially copyable and so
  * a mappable type for the purposes of OpenMP. These constructors and
  * operators *do not* behave atomically, however.
  */
+#ifndef LIBBIRCH_ATOMIC_OPENMP
 #ifndef HAVE_OMP_H
 /* this looks like it's backwards, but when OpenMP is disabled, enabling the
  * OpenMP implementation has the effect of replacing atomic operations with
@@ -34,10 +46,9 @@
  * further review required */
 #define LIBBIRCH_ATOMIC_OPENMP 0
 #endif
+#endif
 
-#if !LIBBIRCH_ATOMIC_OPENMP
 #include <atomic>
-#endif
 
 namespace libbirch {
 /**
@@ -58,35 +69,41 @@ public:
    *
    * @param value Initial value.
    *
-   * Initializes the value, atomically.
+   * Initializes the value, atomically. As the object is under construction,
+   * and not yet visible to other threads, no memory ordering is required.
    */
   explicit Atomic(const T& value) {
-    store(value);
+    store(value, std::memory_order_relaxed);
   }
 
   /**
    * Load the value, atomically.
+   *
+   * @param order Memory order.
    */
-  T load() const {
+  T load(const std::memory_order order = std::memory_order_seq_cst) const {
     T value;
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic read seq_cst
     value = this->value;
     #else
-    value = this->value.load();
+    value = this->value.load(order);
     #endif
     return value;
   }
 
   /**
    * Store the value, atomically.
+   *
+   * @param value New value.
+   * @param order Memory order.
    */
-  void store(const T& value) {
+  void store(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic write seq_cst
     this->value = value;
     #else
-    this->value.store(value);
+    this->value.store(value, order);
     #endif
   }
 
@@ -94,10 +111,11 @@ public:
    * Exchange the value with another, atomically.
    *
    * @param value New value.
+   * @param order Memory order.
    *
    * @return Old value.
    */
-  T exchange(const T& value) {
+  T exchange(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     T old;
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic capture seq_cst
@@ -106,20 +124,56 @@ public:
       this->value = value;
     }
     #else
-    old = this->value.exchange(value);
+    old = this->value.exchange(value, order);
     #endif
     return old;
   }
 
+  /**
+   * Compare the value with an expected value and, if equal, replace it with
+   * a desired value, atomically.
+   *
+   * @param[in,out] expected Expected value. If the comparison fails, this is
+   * updated to the current value.
+   * @param desired Desired value.
+   * @param order Memory order.
+   *
+   * @return Was the value replaced?
+   *
+   * The OpenMP implementation, lacking a compare-and-swap, uses a named
+   * critical region. This is only atomic with respect to other calls of
+   * compareExchange(), not with respect to other operations, so is only
+   * correct in the single-threaded case where OpenMP is disabled.
+   */
+  bool compareExchange(T& expected, const T& desired,
+      const std::memory_order order = std::memory_order_seq_cst) {
+    bool result;
+    #if LIBBIRCH_ATOMIC_OPENMP
+    #pragma omp critical(libbirch_atomic_compare_exchange)
+    {
+      result = (this->value == expected);
+      if (result) {
+        this->value = desired;
+      } else {
+        expected = this->value;
+      }
+    }
+    #else
+    result = this->value.compare_exchange_strong(expected, desired, order);
+    #endif
+    return result;
+  }
+
   /**
    * Apply a mask, with bitwise `and`, and return the previous value,
    * atomically.
    *
    * @param m Mask.
+   * @param order Memory order.
    *
    * @return Previous value.
    */
-  T exchangeAnd(const T& value) {
+  T exchangeAnd(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     T old;
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic capture seq_cst
@@ -128,7 +182,7 @@ public:
       this->value &= value;
     }
     #else
-    old = this->value.fetch_and(value);
+    old = this->value.fetch_and(value, order);
     #endif
     return old;
   }
@@ -138,10 +192,11 @@ public:
    * atomically.
    *
    * @param m Mask.
+   * @param order Memory order.
    *
    * @return Previous value.
    */
-  T exchangeOr(const T& value) {
+  T exchangeOr(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     T old;
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic capture seq_cst
@@ -150,7 +205,7 @@ public:
       this->value |= value;
     }
     #else
-    old = this->value.fetch_or(value);
+    old = this->value.fetch_or(value, order);
     #endif
     return old;
   }
@@ -159,46 +214,104 @@ public:
    * Apply a mask, with bitwise `and`, atomically.
    *
    * @param m Mask.
+   * @param order Memory order.
    */
-  void maskAnd(const T& value) {
+  void maskAnd(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic update seq_cst
-    #endif
     this->value &= value;
+    #else
+    this->value.fetch_and(value, order);
+    #endif
   }
 
   /**
    * Apply a mask, with bitwise `or`, atomically.
    *
    * @param m Mask.
+   * @param order Memory order.
    */
-  void maskOr(const T& value) {
+  void maskOr(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic update seq_cst
-    #endif
     this->value |= value;
+    #else
+    this->value.fetch_or(value, order);
+    #endif
   }
 
   /**
    * Increment the value by one, atomically, but without capturing the
    * current value.
+   *
+   * @param order Memory order.
    */
-  void increment() {
+  void increment(const std::memory_order order = std::memory_order_seq_cst) {
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic update seq_cst
-    #endif
     ++value;
+    #else
+    value.fetch_add(1, order);
+    #endif
   }
 
   /**
    * Decrement the value by one, atomically, but without capturing the
    * current value.
+   *
+   * @param order Memory order.
    */
-  void decrement() {
+  void decrement(const std::memory_order order = std::memory_order_seq_cst) {
     #if LIBBIRCH_ATOMIC_OPENMP
     #pragma omp atomic update seq_cst
-    #endif
     --value;
+    #else
+    value.fetch_sub(1, order);
+    #endif
+  }
+
+  /**
+   * Add to the value, and return the previous value, atomically.
+   *
+   * @param value Value to add.
+   * @param order Memory order.
+   *
+   * @return Previous value.
+   */
+  T exchangeAdd(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
+    T old;
+    #if LIBBIRCH_ATOMIC_OPENMP
+    #pragma omp atomic capture seq_cst
+    {
+      old = this->value;
+      this->value += value;
+    }
+    #else
+    old = this->value.fetch_add(value, order);
+    #endif
+    return old;
+  }
+
+  /**
+   * Subtract from the value, and return the previous value, atomically.
+   *
+   * @param value Value to subtract.
+   * @param order Memory order.
+   *
+   * @return Previous value.
+   */
+  T exchangeSub(const T& value, const std::memory_order order = std::memory_order_seq_cst) {
+    T old;
+    #if LIBBIRCH_ATOMIC_OPENMP
+    #pragma omp atomic capture seq_cst
+    {
+      old = this->value;
+      this->value -= value;
+    }
+    #else
+    old = this->value.fetch_sub(value, order);
+    #endif
+    return old;
   }
 
   /**
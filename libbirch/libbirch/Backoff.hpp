@@ -0,0 +1,82 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "libbirch/external.hpp"
+
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace libbirch {
+/**
+ * Exponential backoff for a thread spinning on a lock.
+ *
+ * @ingroup libbirch
+ *
+ * Each call to pause() spins for twice as many iterations as the last, up to
+ * a limit, issuing the processor's spin-wait hint in each, so as to yield
+ * execution resources to a sibling hyperthread, which may be the holder of
+ * the lock. Once the limit is reached, the backoff is *exhausted*, and
+ * pause() instead yields the thread to the operating system: when there are
+ * more threads than cores, the holder of the lock may not be running, and
+ * spinning further would only burn the rest of the time slice.
+ */
+class Backoff {
+public:
+  /**
+   * Constructor.
+   */
+  Backoff() :
+      n(1u) {
+    //
+  }
+
+  /**
+   * Pause before trying again.
+   */
+  void pause() {
+    if (n <= MAX_SPINS) {
+      for (unsigned i = 0u; i < n; ++i) {
+        relax();
+      }
+      n <<= 1u;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Is the backoff exhausted, such that further pauses yield the thread?
+   * Callers that can block, rather than yield, may prefer to do so once
+   * this is the case.
+   */
+  bool exhausted() const {
+    return n > MAX_SPINS;
+  }
+
+  /**
+   * Issue the processor's spin-wait hint.
+   */
+  static void relax() {
+    #if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+    #elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+    #endif
+  }
+
+private:
+  /**
+   * Number of spin iterations after which the backoff is exhausted.
+   */
+  static constexpr unsigned MAX_SPINS = 1u << 8u;
+
+  /**
+   * Number of spin iterations in the next pause.
+   */
+  unsigned n;
+};
+}
@@ -114,17 +114,24 @@ private:
  */
 template<class P>
 auto clone(const Lazy<P>& o) {
+  ProfileScope scope(TIME_CLONE);
   auto ptr = o.pull();
   auto label = o.getLabel();
 
   finish_lock.enter();
-  ptr->finish(label);
-  label->finish(label);
+  {
+    ProfileScope scope(TIME_FINISH);
+    ptr->finish(label);
+    label->finish(label);
+  }
   finish_lock.exit();
 
   freeze_lock.enter();
-  ptr->freeze();
-  label->freeze();
+  {
+    ProfileScope scope(TIME_FREEZE);
+    ptr->freeze();
+    label->freeze();
+  }
   freeze_lock.exit();
 
   /* shared counts on labels are handled by Any, not Lazy; consequently we
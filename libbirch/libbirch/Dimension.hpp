@@ -34,9 +34,10 @@ struct Dimension: public Length<length_value>, public Stride<stride_value> {
    * @param stride Initial stride.
    *
    * For static values, the initial values given must match the static values
-   * or an error is given.
+   * or an error is given. By default, they are the static values, or zero.
    */
-  Dimension(const int64_t length = 0, const int64_t stride = 0) :
+  Dimension(const int64_t length = length_value,
+      const int64_t stride = stride_value) :
       length_type(length),
       stride_type(stride) {
     libbirch_assert_msg_(length >= 0,
@@ -6,40 +6,87 @@
 #pragma once
 
 #include "libbirch/external.hpp"
+#include "libbirch/mutable.hpp"
 
 namespace libbirch {
+/**
+ * Eigen size for a static value, or Eigen::Dynamic if it is mutable.
+ */
+constexpr int eigen_size(const int64_t n) {
+  return n == mutable_value ? Eigen::Dynamic : int(n);
+}
 
 using EigenVectorStride = Eigen::Stride<Eigen::Dynamic,Eigen::Dynamic>;
-template<class Type>
-using EigenVector = Eigen::Matrix<Type,Eigen::Dynamic,1,Eigen::ColMajor,Eigen::Dynamic,1>;
+template<class Type, int Rows = Eigen::Dynamic>
+using EigenVector = Eigen::Matrix<Type,Rows,1,Eigen::ColMajor,Rows,1>;
 template<class Type>
 using EigenVectorMap = Eigen::Map<EigenVector<Type>,Eigen::DontAlign,EigenVectorStride>;
 
 using EigenMatrixStride = Eigen::Stride<Eigen::Dynamic,Eigen::Dynamic>;
-template<class Type>
-using EigenMatrix = Eigen::Matrix<Type,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor,Eigen::Dynamic,Eigen::Dynamic>;
+template<class Type, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
+using EigenMatrix = Eigen::Matrix<Type,Rows,Cols,Eigen::RowMajor,Rows,Cols>;
 template<class Type>
 using EigenMatrixMap = Eigen::Map<EigenMatrix<Type>,Eigen::DontAlign,EigenMatrixStride>;
 
+/*
+ * Eigen type for a one-dimensional shape. Static lengths and strides of the
+ * shape become fixed sizes and strides of the Eigen type.
+ */
+template<class Type, class ShapeType>
+struct eigen_vector_type {
+  using head_type = typename ShapeType::head_type;
+  static const int rows = eigen_size(head_type::length_value);
+  static const int inner = eigen_size(head_type::stride_value);
+
+  using stride_type = Eigen::Stride<Eigen::Dynamic,inner>;
+  using type = Eigen::Map<EigenVector<Type,rows>,Eigen::DontAlign,stride_type>;
+};
+
+/*
+ * Eigen type for a two-dimensional shape. A static number of columns of one
+ * is not kept, as Eigen does not support row-major matrices with a single
+ * column.
+ */
+template<class Type, class ShapeType>
+struct eigen_matrix_type {
+  using head_type = typename ShapeType::head_type;
+  using next_type = typename ShapeType::tail_type::head_type;
+  static const int rows = eigen_size(head_type::length_value);
+  static const int cols = next_type::length_value == 1 ? Eigen::Dynamic :
+      eigen_size(next_type::length_value);
+  static const int outer = eigen_size(head_type::stride_value);
+  static const int inner = eigen_size(next_type::stride_value);
+
+  using stride_type = Eigen::Stride<outer,inner>;
+  using type = Eigen::Map<EigenMatrix<Type,rows,cols>,Eigen::DontAlign,stride_type>;
+};
+
 /*
  * Eigen type for an array type.
  */
-template<class ArrayType>
+template<class ArrayType, int D = ArrayType::shape_type::count()>
 struct eigen_type {
-  using type = typename std::conditional<ArrayType::shape_type::count() == 2,
-      EigenMatrixMap<typename ArrayType::value_type>,
-    typename std::conditional<ArrayType::shape_type::count() == 1,
-      EigenVectorMap<typename ArrayType::value_type>,
-    void>::type>::type;
+  using type = void;
+  using stride_type = void;
+};
+template<class ArrayType>
+struct eigen_type<ArrayType,1> {
+  using impl = eigen_vector_type<typename ArrayType::value_type,
+      typename ArrayType::shape_type>;
+  using type = typename impl::type;
+  using stride_type = typename impl::stride_type;
+};
+template<class ArrayType>
+struct eigen_type<ArrayType,2> {
+  using impl = eigen_matrix_type<typename ArrayType::value_type,
+      typename ArrayType::shape_type>;
+  using type = typename impl::type;
+  using stride_type = typename impl::stride_type;
 };
 
 template<class ArrayType>
 struct eigen_stride_type {
-  using type = typename std::conditional<ArrayType::shape_type::count() == 2,
-      EigenMatrixStride,
-    typename std::conditional<ArrayType::shape_type::count() == 1,
-      EigenVectorStride,
-    void>::type>::type;
+  using type = typename eigen_type<ArrayType>::stride_type;
 };
 
 /*
@@ -50,7 +97,7 @@ struct is_eigen_compatible {
   static const bool value =
       std::is_same<typename ArrayType::value_type,typename EigenType::value_type>::value &&
           ((ArrayType::shape_type::count() == 1 && EigenType::ColsAtCompileTime == 1) ||
-           (ArrayType::shape_type::count() == 2 && EigenType::ColsAtCompileTime == Eigen::Dynamic));
+           (ArrayType::shape_type::count() == 2 && EigenType::ColsAtCompileTime != 1));
 };
 
 template<class ArrayType, class EigenType>
@@ -64,7 +111,7 @@ template<class ArrayType, class EigenType>
 struct is_triangle_compatible {
   static const bool value =
       std::is_same<typename ArrayType::value_type,typename EigenType::value_type>::value &&
-          ArrayType::shape_type::count() == 2 && EigenType::ColsAtCompileTime == Eigen::Dynamic;
+          ArrayType::shape_type::count() == 2 && EigenType::ColsAtCompileTime != 1;
 };
 
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "libbirch/Atomic.hpp"
+#include "libbirch/Backoff.hpp"
 
 namespace libbirch {
 /**
@@ -56,6 +57,10 @@ inline void libbirch::ExitBarrierLock::exit() {
   if (--ninternal == 0) {
     return;
   } else {
-    while (ninternal.load() != 0);  // spin until the entry gate is open
+    /* spin until the entry gate is open */
+    Backoff backoff;
+    while (ninternal.load() != 0) {
+      backoff.pause();
+    }
   }
 }
@@ -3,31 +3,49 @@
  */
 #include "libbirch/Label.hpp"
 
-libbirch::Label::Label() : Any(0) {
-  //
+libbirch::Label::Label() :
+    Any(0),
+    flatten(false) {
+  assert(reinterpret_cast<std::uintptr_t>(this) % alignof(Label) == 0u);
 }
 
 libbirch::Label::Label(const Label& o) :
     Label() {
   auto& o1 = const_cast<Label&>(o);
   o1.lock.setWrite();
-  o1.memo.rehash();
+  auto flatten = o1.flatten.exchange(false, std::memory_order_relaxed);
+  if (flatten || o1.memo.bloated()) {
+    o1.memo.compact();
+  } else {
+    o1.memo.rehash();
+  }
   o1.lock.downgrade();
   memo.copy(o1.memo);
   o1.lock.unsetRead();
 }
 
+void libbirch::Label::compact() {
+  lock.setWrite();
+  flatten.store(false, std::memory_order_relaxed);
+  memo.compact();
+  lock.unsetWrite();
+}
+
 libbirch::Any* libbirch::Label::mapGet(Any* o) {
+  ProfileScope scope(TIME_MAP_GET);
   Any* prev = nullptr;
   Any* next = o;
   bool frozen = o->isFrozen();
+  unsigned length = 0u;
   while (frozen && next) {
     prev = next;
     next = memo.get(prev);
     if (next) {
       frozen = next->isFrozen();
+      ++length;
     }
   }
+  chain(length);
   if (!next) {
 	  next = prev;
 	}
@@ -37,15 +55,16 @@ libbirch::Any* libbirch::Label::mapGet(Any* o) {
        * remaining pointer to the object, rather than copying the object and
        * then destroying it, recycle the object to be the copy */
       next->recycle(this);
+      profile_count(COUNT_RECYCLES);
     } else {
       /* copy the object */
       auto copied = next->copy(this);
+      profile_count(COUNT_COPIES);
 
       /* single-reference optimization: at the time of freezing, if there was
        * only one reference to the object, it need not be memoized, as there
        * are no other pointers to update to the copy */
       if (!next->isFrozenUnique()) {
-        thaw();
         memo.put(next, copied);
       }
       next = copied;
@@ -56,16 +75,20 @@ libbirch::Any* libbirch::Label::mapGet(Any* o) {
 }
 
 libbirch::Any* libbirch::Label::mapPull(Any* o) {
+  ProfileScope scope(TIME_MAP_PULL);
   Any* prev = nullptr;
   Any* next = o;
   bool frozen = o->isFrozen();
+  unsigned length = 0u;
   while (frozen && next) {
     prev = next;
     next = memo.get(prev);
     if (next) {
       frozen = next->isFrozen();
+      ++length;
     }
   }
+  chain(length);
   if (!next) {
 	  next = prev;
 	}
@@ -73,14 +96,16 @@ libbirch::Any* libbirch::Label::mapPull(Any* o) {
 }
 
 libbirch::Any* libbirch::Label::mapCopy(Any* o) {
+  ProfileScope scope(TIME_MAP_COPY);
+
   /* copy the object */
   auto next = o->copy(this);
+  profile_count(COUNT_COPIES);
 
   /* single-reference optimization: at the time of freezing, if there was
    * only one reference to the object, it need not be memoized, as there
    * are no other pointers to update to the copy */
   if (!o->isFrozenUnique()) {
-    thaw();
     memo.put(o, next);
   }
   return next;
@@ -110,7 +110,34 @@ public:
     return ptr;
   }
 
+  /**
+   * Compact the memo, flattening chains of mappings and removing entries
+   * for objects that are no longer reachable. This is performed
+   * automatically when the label is copied, if the memo has become bloated
+   * or long chains of mappings have been followed, but may also be
+   * triggered explicitly.
+   */
+  void compact();
+
 private:
+  /**
+   * Note the length of a chain of mappings followed in the memo, flagging
+   * the memo for compaction if it is too long. A chain of nonzero length is
+   * a hit in the memo, otherwise a miss.
+   */
+  void chain(const unsigned length) {
+    profile_count(length > 0u ? COUNT_MEMO_HITS : COUNT_MEMO_MISSES);
+    if (length > MAX_CHAIN) {
+      flatten.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Maximum length of a chain of mappings before the memo is flagged for
+   * compaction.
+   */
+  static constexpr unsigned MAX_CHAIN = 4u;
+
   /**
    * Map an object that may not yet have been cloned, cloning it if
    * necessary.
@@ -134,11 +161,34 @@ private:
   Memo memo;
 
   /**
-   * Lock.
+   * Has a long chain of mappings been followed in the memo since it was
+   * last compacted?
    */
-  ReadersWriterLock lock;
+  Atomic<bool> flatten;
+
+  /**
+   * Lock. This is aligned to a cache line, so that it does not share one
+   * with the reference counts, the memo, or the flag above. The size of
+   * Label is then a multiple of the cache line size too, which allocate()
+   * aligns to 64 bytes, and nothing that follows in memory shares the line
+   * of the lock either.
+   */
+  alignas(64) ReadersWriterLock lock;
+  static_assert(sizeof(ReadersWriterLock) <= 64,
+      "lock does not fit in a cache line");
 
 public:
+  void* operator new(std::size_t size) {
+    if (memory_stats) {
+      count_object("Label", 1);
+    }
+    return allocate(size);
+  }
+
+  void operator delete(void* ptr) {
+    Any::operator delete(ptr);
+  }
+
   virtual const char* getClassName() const override {
     return "Label";
   }
@@ -185,6 +235,8 @@ public:
 
   using base_type = Any;
 };
+static_assert(sizeof(Label) % 64 == 0,
+    "allocate() aligns Label to a cache line only if its size is a multiple of 64");
 
 template<unsigned N>
 struct is_acyclic_class<Label,N> {
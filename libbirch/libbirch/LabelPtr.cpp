@@ -17,11 +17,11 @@ libbirch::LabelPtr::LabelPtr(const LabelPtr& o) {
   if (ptr && ptr != root()) {
     ptr->incShared();
   }
-  this->ptr.store(ptr);
+  this->ptr.store(ptr, std::memory_order_relaxed);
 }
 
 libbirch::LabelPtr::LabelPtr(LabelPtr&& o) {
-  ptr.store(o.ptr.exchange(nullptr));
+  ptr.store(o.ptr.exchange(nullptr), std::memory_order_relaxed);
 }
 
 libbirch::LabelPtr::~LabelPtr() {
@@ -94,7 +94,7 @@ void libbirch::LabelPtr::mark() {
   /* c.f. Shared::mark(); because we don't keep a shared reference to the root
    * label, it is not necessary to recurse into it */
   auto o = ptr.load();
-  if (o && o != root()) {
+  if (o && o != root() && !o->isSkipped()) {
     o->decSharedReachable();
     o->mark();
   }
@@ -104,7 +104,7 @@ void libbirch::LabelPtr::scan() {
   /* c.f. Shared::scan(); because we don't keep a shared reference to the root
    * label, it is not necessary to recurse into it */
   auto o = ptr.load();
-  if (o && o != root()) {
+  if (o && o != root() && !o->isSkipped()) {
     o->scan();
   }
 }
@@ -113,7 +113,7 @@ void libbirch::LabelPtr::reach() {
   /* c.f. Shared::reach(); because we don't keep a shared reference to the
    * root label, it is not necessary to recurse into it */
   auto o = ptr.load();
-  if (o && o != root()) {
+  if (o && o != root() && !o->isSkipped()) {
     o->incShared();
     o->reach();
   }
@@ -122,8 +122,9 @@ void libbirch::LabelPtr::reach() {
 void libbirch::LabelPtr::collect() {
   /* c.f. Shared::collect(); because we don't keep a shared reference to the
    * root label, it is not necessary to recurse into it */
-  auto o = ptr.exchange(nullptr);
-  if (o && o != root()) {
+  auto o = ptr.load();
+  if (o && o != root() && !o->isSkipped()) {
+    ptr.store(nullptr);
     o->collect();
   }
 }
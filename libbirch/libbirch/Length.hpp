@@ -4,6 +4,7 @@
 #pragma once
 
 #include "libbirch/mutable.hpp"
+#include "libbirch/assert.hpp"
 
 namespace libbirch {
 /**
@@ -17,7 +18,8 @@ struct Length {
   static const int64_t length = n;
 
   Length(const int64_t length) {
-    assert(length == this->length);
+    libbirch_error_msg_(length == n, "length is " << length <<
+        " for dimension of fixed length " << n);
   }
 };
 template<>
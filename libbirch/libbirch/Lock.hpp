@@ -5,12 +5,24 @@
 
 #include "libbirch/external.hpp"
 #include "libbirch/Atomic.hpp"
+#include "libbirch/Backoff.hpp"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 namespace libbirch {
 /**
  * Lock with exclusive use semantics.
  *
  * @ingroup libbirch
+ *
+ * A thread that finds the lock held spins with exponential backoff (see
+ * Backoff) and, once that is exhausted, yields a number of times before
+ * parking until the lock is released: on Linux, it sleeps on a futex,
+ * otherwise it continues to yield. Releasing the lock only makes a system
+ * call to wake a thread if one may be parked.
  */
 class Lock {
 public:
@@ -18,7 +30,8 @@ public:
    * Constructor.
    */
   Lock() :
-    lock(false) {
+    lock(0u),
+    nparked(0u) {
     //
   }
 
@@ -35,29 +48,90 @@ public:
    * Correctly initialize after a bitwise copy.
    */
   void bitwiseFix() {
-    lock.store(false);
+    lock.store(0u);
+    nparked.store(0u);
   }
 
   /**
    * Obtain exclusive use.
    */
   void set() {
-    /* spin, setting the lock true until its old value comes back false */
-    while (lock.exchange(true));
+    /* set the lock true until its old value comes back false, testing
+     * before each further attempt so as to spin on a shared copy of the
+     * cache line */
+    if (lock.exchange(1u)) {
+      Backoff backoff;
+      unsigned nyields = 0u;
+      do {
+        if (!backoff.exhausted() || ++nyields <= MAX_YIELDS) {
+          backoff.pause();
+        } else {
+          park();
+        }
+      } while (lock.load(std::memory_order_relaxed) || lock.exchange(1u));
+    }
   }
 
-
   /**
    * Release exclusive use.
    */
   void unset() {
-    lock.store(false);
+    lock.store(0u);
+    if (nparked.load()) {
+      wake();
+    }
   }
 
 private:
   /**
-   * Lock.
+   * Park the calling thread until the lock may have been released.
+   */
+  void park() {
+    #ifdef __linux__
+    /* the count is incremented before the lock is checked by the system
+     * call, while unset() releases the lock before checking the count, so
+     * that either the system call sees the release, and returns
+     * immediately, or unset() sees the count, and wakes this thread */
+    nparked.increment();
+    syscall(SYS_futex, word(), FUTEX_WAIT_PRIVATE, 1u, nullptr, nullptr, 0);
+    nparked.decrement();
+    #else
+    std::this_thread::yield();
+    #endif
+  }
+
+  /**
+   * Wake a parked thread.
+   */
+  void wake() {
+    #ifdef __linux__
+    syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    #endif
+  }
+
+  /**
+   * Address of the lock as a word, for system calls.
+   */
+  unsigned* word() {
+    static_assert(sizeof(lock) == sizeof(unsigned),
+        "Atomic<unsigned> is not a plain word");
+    return reinterpret_cast<unsigned*>(&lock);
+  }
+
+  /**
+   * Number of times to yield, once the backoff is exhausted, before
+   * parking.
+   */
+  static constexpr unsigned MAX_YIELDS = 16u;
+
+  /**
+   * Lock; nonzero when held.
+   */
+  Atomic<unsigned> lock;
+
+  /**
+   * Number of threads parked, or about to park, on the lock.
    */
-  Atomic<bool> lock;
+  Atomic<unsigned> nparked;
 };
 }
@@ -6,29 +6,29 @@
 #include "libbirch/Any.hpp"
 
 libbirch::Memo::Memo() :
-    keys(nullptr),
-    values(nullptr),
+    entries(nullptr),
     nentries(0u),
     tentries(0u),
     noccupied(0u),
-    nnew(0u) {
+    nnew(0u),
+    ncompacted(0u),
+    ngenerations(0u) {
   //
 }
 
 libbirch::Memo::~Memo() {
   if (nentries > 0u) {
     for (unsigned i = 0u; i < nentries; ++i) {
-      auto key = keys[i];
+      auto key = entries[i].key;
       if (key) {
         key->decMemo();
-        auto value = values[i];
+        auto value = entries[i].value;
         if (value) {  // may be null if collect() already destroyed
           value->decShared();
         }
       }
     }
-    deallocate(keys, nentries * sizeof(key_type), tentries);
-    deallocate(values, nentries * sizeof(value_type), tentries);
+    deallocate(entries, nentries * sizeof(entry_type), tentries);
   }
 }
 
@@ -37,15 +37,15 @@ libbirch::Memo::value_type libbirch::Memo::get(const key_type key,
   assert(key);
 
   auto value = failed;
-  if (!empty()) {
+  if (!empty() && key->numMemo() > 1u) {
     auto i = hash(key, nentries);
-    auto k = keys[i];
+    auto k = entries[i].key;
     while (k && k != key) {
       i = (i + 1u) & (nentries - 1u);
-      k = keys[i];
+      k = entries[i].key;
     }
     if (k == key) {
-      value = values[i];
+      value = entries[i].value;
     }
   }
   return value;
@@ -60,14 +60,14 @@ void libbirch::Memo::put(const key_type key, const value_type value) {
 
   reserve();
   auto i = hash(key, nentries);
-  auto k = keys[i];
+  auto k = entries[i].key;
   while (k) {
     assert(k != key);
     i = (i + 1u) & (nentries - 1u);
-    k = keys[i];
+    k = entries[i].key;
   }
-  keys[i] = key;
-  values[i] = value;
+  entries[i].key = key;
+  entries[i].value = value;
 }
 
 void libbirch::Memo::copy(const Memo& o) {
@@ -77,24 +77,25 @@ void libbirch::Memo::copy(const Memo& o) {
    * size and remove unreachable entries, so now just copy entry-by-entry */
   if (o.nentries > 0u) {
     /* allocate */
-    keys = (key_type*)allocate(o.nentries * sizeof(key_type));
-    values = (value_type*)allocate(o.nentries * sizeof(value_type));
+    entries = (entry_type*)allocate(o.nentries * sizeof(entry_type));
     nentries = o.nentries;
     tentries = get_thread_num();
     noccupied = o.noccupied;
     nnew = o.nnew;
+    ncompacted = o.ncompacted;
+    ngenerations = o.ngenerations + 1u;
 
     /* copy entry-by-entry, incrementing reference counts for non-null
      * entries */
     for (auto i = 0u; i < nentries; ++i) {
-      auto key = o.keys[i];
-      auto value = o.values[i];
+      auto key = o.entries[i].key;
+      auto value = o.entries[i].value;
       if (key) {
         key->incMemo();
         value->incShared();
       }
-      keys[i] = key;
-      values[i] = value;
+      entries[i].key = key;
+      entries[i].value = value;
     }
   }
 }
@@ -109,106 +110,106 @@ void libbirch::Memo::reserve() {
 
 void libbirch::Memo::rehash() {
   if (nnew > 0u) {  // no need to rehash if no new entries since last time
-    nnew = 0u;
-    unsigned nremoved = 0u;
+    compact();
+  }
+}
 
-    /* first pass, apply the table to itself; this has the effect of
-     * replacing a -> b and b -> c with a -> c and b -> c, which may allow
-     * b to be collected sooner */
-    for (auto i = 0u; i < nentries; ++i) {
-      auto value = values[i];
-      if (value) {
-        auto prev = value;
-        auto next = value;
-        do {
-          prev = next;
-          next = get(prev);
-        } while (next);
-        if (prev != value) {
-          prev->incShared();
-          value->decShared();
-          values[i] = prev;
-        }
-      }
-    }
+void libbirch::Memo::compact() {
+  ProfileScope scope(TIME_COMPACT);
+  nnew = 0u;
+  unsigned nremoved = 0u;
 
-    /* second pass, delete any entries where the key is no longer reachable;
-     * from this point, the old buffers are no long valid as a hash table */
-    for (auto i = 0u; i < nentries; ++i) {
-      auto key = keys[i];
-      if (key && key->isDestroyed()) {
-        auto value = values[i];
-        key->decMemo();
+  /* first pass, apply the table to itself; this has the effect of
+   * replacing a -> b and b -> c with a -> c and b -> c, which may allow
+   * b to be collected sooner */
+  for (auto i = 0u; i < nentries; ++i) {
+    auto value = entries[i].value;
+    if (value) {
+      auto prev = value;
+      auto next = value;
+      do {
+        prev = next;
+        next = get(prev);
+      } while (next);
+      if (prev != value) {
+        prev->incShared();
         value->decShared();
-        keys[i] = nullptr;
-        values[i] = nullptr;
-        ++nremoved;
+        entries[i].value = prev;
       }
     }
-    noccupied -= nremoved;
+  }
 
-    if (noccupied == 0u) {
-      /* deallocate previous table */
-      if (nentries > 0) {
-        deallocate(keys, nentries * sizeof(key_type), tentries);
-        deallocate(values, nentries * sizeof(value_type), tentries);
-      }
+  /* second pass, delete any entries where the key is no longer reachable;
+   * from this point, the old buffer is no longer valid as a hash table */
+  for (auto i = 0u; i < nentries; ++i) {
+    auto key = entries[i].key;
+    if (key && key->isDestroyed()) {
+      auto value = entries[i].value;
+      key->decMemo();
+      value->decShared();
+      entries[i].key = nullptr;
+      entries[i].value = nullptr;
+      ++nremoved;
+    }
+  }
+  noccupied -= nremoved;
 
-      /* new table empty */
-      nentries = 0u;
-      tentries = 0u;
-      keys = nullptr;
-      values = nullptr;
-    } else {
-      /* save previous table */
-      auto nentries1 = nentries;
-      auto tentries1 = tentries;
-      auto keys1 = keys;
-      auto values1 = values;
+  if (noccupied == 0u) {
+    /* deallocate previous table */
+    if (nentries > 0) {
+      deallocate(entries, nentries * sizeof(entry_type), tentries);
+    }
 
-      /* choose an appropriate size for the new table */
-      unsigned minSize = 8u;
-      nentries = std::max(2u*nentries1, minSize);
-      while (minSize < nentries && noccupied <= crowd()/2) {
-        nentries /= 2u;
-      }
+    /* new table empty */
+    nentries = 0u;
+    tentries = 0u;
+    entries = nullptr;
+  } else {
+    /* save previous table */
+    auto nentries1 = nentries;
+    auto tentries1 = tentries;
+    auto entries1 = entries;
+
+    /* choose an appropriate size for the new table */
+    unsigned minSize = 8u;
+    nentries = std::max(2u*nentries1, minSize);
+    while (minSize < nentries && noccupied <= crowd()/2) {
+      nentries /= 2u;
+    }
 
-      if (nentries != nentries1 || nremoved > 0u) {
-        /* allocate the new table */
-        keys = (key_type*)allocate(nentries * sizeof(key_type));
-        values = (value_type*)allocate(nentries * sizeof(value_type));
-        std::memset(keys, 0, nentries * sizeof(key_type));
-        std::memset(values, 0, nentries * sizeof(value_type));
-        tentries = get_thread_num();
+    if (nentries != nentries1 || nremoved > 0u) {
+      /* allocate the new table */
+      entries = (entry_type*)allocate(nentries * sizeof(entry_type));
+      std::memset(entries, 0, nentries * sizeof(entry_type));
+      tentries = get_thread_num();
 
-        /* copy entries from previous table */
-        for (auto i = 0u; i < nentries1; ++i) {
-          auto key = keys1[i];
-          if (key) {
-            auto j = hash(key, nentries);
-            while (keys[j]) {
-              j = (j + 1u) & (nentries - 1u);
-            }
-            keys[j] = key;
-            values[j] = values1[i];
+      /* copy entries from previous table */
+      for (auto i = 0u; i < nentries1; ++i) {
+        auto key = entries1[i].key;
+        if (key) {
+          auto j = hash(key, nentries);
+          while (entries[j].key) {
+            j = (j + 1u) & (nentries - 1u);
           }
+          entries[j] = entries1[i];
         }
+      }
 
-        /* deallocate previous table */
-        if (nentries1 > 0u) {
-          deallocate(keys1, nentries1 * sizeof(key_type), tentries1);
-          deallocate(values1, nentries1 * sizeof(value_type), tentries1);
-        }
+      /* deallocate previous table */
+      if (nentries1 > 0u) {
+        deallocate(entries1, nentries1 * sizeof(entry_type), tentries1);
       }
     }
   }
+  ncompacted = noccupied;
+  ngenerations = 0u;
 }
 
 void libbirch::Memo::finish(Label* label) {
   for (auto i = 0u; i < nentries; ++i) {
-    auto key = keys[i];
+    auto key = entries[i].key;
     if (key && !key->isDestroyed()) {
-      auto value = values[i];
+      auto value = entries[i].value;
       value->finish(label);
     }
   }
@@ -216,9 +217,9 @@ void libbirch::Memo::finish(Label* label) {
 
 void libbirch::Memo::freeze() {
   for (auto i = 0u; i < nentries; ++i) {
-    auto key = keys[i];
+    auto key = entries[i].key;
     if (key && !key->isDestroyed()) {
-      auto value = values[i];
+      auto value = entries[i].value;
       value->freeze();
     }
   }
@@ -226,8 +227,8 @@ void libbirch::Memo::freeze() {
 
 void libbirch::Memo::mark() {
   for (auto i = 0u; i < nentries; ++i) {
-    auto value = values[i];
-    if (value) {
+    auto value = entries[i].value;
+    if (value && !value->isSkipped()) {
       value->decSharedReachable();  // break the reference
       value->mark();
     }
@@ -236,8 +237,8 @@ void libbirch::Memo::mark() {
 
 void libbirch::Memo::scan() {
   for (auto i = 0u; i < nentries; ++i) {
-    auto value = values[i];
-    if (value) {
+    auto value = entries[i].value;
+    if (value && !value->isSkipped()) {
       value->scan();
     }
   }
@@ -245,8 +246,8 @@ void libbirch::Memo::scan() {
 
 void libbirch::Memo::reach() {
   for (auto i = 0u; i < nentries; ++i) {
-    auto value = values[i];
-    if (value) {
+    auto value = entries[i].value;
+    if (value && !value->isSkipped()) {
       value->incShared();  // restore the broken reference
       value->reach();
     }
@@ -255,9 +256,9 @@ void libbirch::Memo::reach() {
 
 void libbirch::Memo::collect() {
   for (auto i = 0u; i < nentries; ++i) {
-    auto value = values[i];
-    if (value) {
-      values[i] = nullptr;
+    auto value = entries[i].value;
+    if (value && !value->isSkipped()) {
+      entries[i].value = nullptr;
       value->collect();
     }
   }
@@ -13,6 +13,12 @@ class Label;
  * Memo of object mappings, implemented as a hash table.
  *
  * @ingroup libbirch
+ *
+ * The table uses open addressing with linear probing. Each key is stored
+ * alongside its value, so that a successful lookup touches a single cache
+ * line in the common case of a short probe sequence. Entries are never
+ * removed individually, only when the table is rebuilt by rehash(), so that
+ * no tombstones are required.
  */
 class Memo {
 public:
@@ -26,6 +32,21 @@ public:
    */
   using value_type = Any*;
 
+  /**
+   * Entry type.
+   */
+  struct entry_type {
+    /**
+     * Key, or null if the entry is unoccupied.
+     */
+    key_type key;
+
+    /**
+     * Value.
+     */
+    value_type value;
+  };
+
   /**
    * Constructor.
    */
@@ -48,6 +69,11 @@ public:
    *
    * @return If @p key exists, then its associated value, otherwise
    * @p failed.
+   *
+   * The key must be reachable, i.e. have a nonzero shared count. Such a key
+   * with a memo count of one is not in the table of any memo, so that a miss
+   * on it, which is the usual end of a chain of mappings, is determined from
+   * the object itself, without probing the table.
    */
   value_type get(const key_type key, const value_type failed = nullptr);
 
@@ -66,10 +92,24 @@ public:
   void copy(const Memo& o);
 
   /**
-   * Rehash the table. This will also remove unreachable entries.
+   * Rehash the table, if there are new entries since the last rehash. This
+   * will also flatten chains of entries and remove unreachable entries.
    */
   void rehash();
 
+  /**
+   * Compact the table. This is as rehash(), but is performed regardless of
+   * whether there are new entries, so as to also remove entries that have
+   * become unreachable since.
+   */
+  void compact();
+
+  /**
+   * Has the table grown enough since it was last compacted that it should
+   * be compacted again?
+   */
+  bool bloated() const;
+
   /**
    * Finish values.
    */
@@ -104,6 +144,16 @@ private:
   /**
    * Compute the hash code for a given key for a table with the given number
    * of entries.
+   *
+   * This uses multiplicative hashing. Keys are addresses of objects, which
+   * are aligned, and allocated in runs of similar size, so that their low
+   * bits are poorly distributed; multiplication by 2^64/phi mixes them into
+   * the upper bits of the product. The hash code is taken from the low bits
+   * of the upper 32-bit word of the product, not from its top bits as in
+   * Fibonacci hashing proper: keys allocated at a fixed stride form an
+   * arithmetic progression, and the top bits of their products cluster
+   * whenever the stride multiplied by 1/phi is near a simple fraction, as it
+   * is for common block sizes, while the lower bits do not.
    */
   static unsigned hash(const key_type key, const unsigned nentries);
 
@@ -120,14 +170,9 @@ private:
   void reserve();
   
   /**
-   * The keys.
-   */
-  key_type* keys;
-
-  /**
-   * The values.
+   * The entries.
    */
-  value_type* values;
+  entry_type* entries;
 
   /**
    * Number of entries in the table.
@@ -135,7 +180,7 @@ private:
   unsigned nentries;
 
   /**
-   * Id of the thread that allocated keys and values.
+   * Id of the thread that allocated the entries.
    */
   int tentries;
 
@@ -148,6 +193,18 @@ private:
    * Number of new entries since last rehash.
    */
   unsigned nnew;
+
+  /**
+   * Number of occupied entries in the table after it was last compacted.
+   */
+  unsigned ncompacted;
+
+  /**
+   * Number of generations of copies of the table since it was last
+   * compacted, i.e. the length of the chain of labels through which it has
+   * been inherited.
+   */
+  unsigned ngenerations;
 };
 }
 
@@ -157,8 +214,8 @@ inline bool libbirch::Memo::empty() const {
 
 inline unsigned libbirch::Memo::hash(const key_type key, const unsigned nentries) {
   assert(nentries > 0u);
-  return static_cast<unsigned>(reinterpret_cast<size_t>(key) >> 6ull)
-      & (nentries - 1u);
+  auto h = reinterpret_cast<size_t>(key)*11400714819323198485ull;
+  return static_cast<unsigned>(h >> 32ull) & (nentries - 1u);
 }
 
 inline unsigned libbirch::Memo::crowd() const {
@@ -166,3 +223,11 @@ inline unsigned libbirch::Memo::crowd() const {
    * entries are occupied */
   return (nentries >> 1u) + (nentries >> 2u);
 }
+
+inline bool libbirch::Memo::bloated() const {
+  /* the table is considered bloated if it has been inherited through a
+   * long enough chain of labels, or the number of occupied entries has
+   * doubled, since the last compaction, ignoring small tables */
+  return noccupied >= 64u && (ngenerations >= 8u ||
+      noccupied >= 2u*ncompacted);
+}
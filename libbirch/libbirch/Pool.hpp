@@ -3,7 +3,7 @@
  */
 #pragma once
 
-#include "libbirch/Lock.hpp"
+#include "libbirch/Atomic.hpp"
 #include "libbirch/memory.hpp"
 
 namespace libbirch {
@@ -17,6 +17,13 @@ namespace libbirch {
  * block is at least 8 bytes in size, when in the pool (and therefore
  * not in use), its first 8 bytes are used to store a pointer to the next
  * block on the stack. The implementation is lock-free.
+ *
+ * The top of the stack is kept as a pointer packed with a tag in its upper
+ * 16 bits. The tag is incremented on every update, so that a pop() that
+ * reads the top, is preempted while other threads pop and push the same
+ * block, then resumes, fails its compare-and-swap rather than installing
+ * a stale next pointer (the ABA problem). This relies on user-space
+ * addresses fitting in the lower 48 bits, as they do on x86-64 and AArch64.
  */
 class Pool {
 public:
@@ -24,7 +31,7 @@ public:
    * Constructor.
    */
   Pool() :
-      top(nullptr) {
+      top(0ull) {
     //
   }
 
@@ -32,7 +39,7 @@ public:
    * Is the pool empty?
    */
   bool empty() const {
-    return !top;
+    return !unpack(top.load());
   }
 
   /**
@@ -40,10 +47,14 @@ public:
    * empty.
    */
   void* pop() {
-    lock.set();
-    auto result = top;
-    top = getNext(result);
-    lock.unset();
+    auto old = top.load();
+    void* result;
+    do {
+      result = unpack(old);
+      if (!result) {
+        return nullptr;
+      }
+    } while (!top.compareExchange(old, pack(getNext(result), old)));
     return result;
   }
 
@@ -51,13 +62,34 @@ public:
    * Push an allocation to the pool.
    */
   void push(void* block) {
-    lock.set();
-    setNext(block, top);
-    top = block;
-    lock.unset();
+    pushAll(block, block);
+  }
+
+  /**
+   * Pop all allocations from the pool. Returns the first allocation of a
+   * list linked with getNext(), or `nullptr` if the pool is empty.
+   */
+  void* popAll() {
+    auto old = top.load();
+    while (unpack(old) && !top.compareExchange(old, pack(nullptr, old)));
+    return unpack(old);
+  }
+
+  /**
+   * Push a list of allocations, linked with setNext(), to the pool.
+   *
+   * @param first First allocation in the list.
+   * @param last Last allocation in the list.
+   */
+  void pushAll(void* first, void* last) {
+    assert(first);
+    assert(last);
+    auto old = top.load();
+    do {
+      setNext(last, unpack(old));
+    } while (!top.compareExchange(old, pack(first, old)));
   }
 
-private:
   /**
    * Get the first 8 bytes of a block as a pointer.
    */
@@ -73,14 +105,26 @@ private:
     *reinterpret_cast<void**>(block) = next;
   }
 
+private:
+  /**
+   * Pack a block pointer with the tag following that of a previous top.
+   */
+  static uint64_t pack(void* block, const uint64_t prev) {
+    auto address = reinterpret_cast<uint64_t>(block);
+    assert((address >> 48ull) == 0ull);
+    return address | (((prev >> 48ull) + 1ull) << 48ull);
+  }
+
   /**
-   * Stack of allocations.
+   * Unpack the block pointer from a top.
    */
-  void* top;
+  static void* unpack(const uint64_t top) {
+    return reinterpret_cast<void*>(top & ((1ull << 48ull) - 1ull));
+  }
 
   /**
-   * Mutex.
+   * Top of the stack, a pointer packed with a tag.
    */
-  Lock lock;
+  Atomic<uint64_t> top;
 };
 }
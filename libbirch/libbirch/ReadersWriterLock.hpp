@@ -4,12 +4,110 @@
 #pragma once
 
 #include "libbirch/external.hpp"
+#include "libbirch/thread.hpp"
 #include "libbirch/Atomic.hpp"
+#include "libbirch/Backoff.hpp"
 
 namespace libbirch {
+/**
+ * Read registrations of a single thread, and a record of the readers-writer
+ * locks that it holds, see ReadersWriterLock. Each thread has its own,
+ * padded to a cache line, so that registering a read writes only to a line
+ * that the thread already holds.
+ *
+ * @ingroup libbirch
+ */
+struct ReaderSlots {
+  /**
+   * Maximum number of reads that may be registered at once. Further nested
+   * reads fall back to the shared count of the lock.
+   */
+  static constexpr int N = 7;
+
+  /**
+   * Maximum number of nested locks for which `mask` records how the lock is
+   * held. Locks nested more deeply do not register reads in slots.
+   */
+  static constexpr int M = 32;
+
+  /**
+   * Locks on which the thread holds a read, as a stack.
+   */
+  Atomic<const void*> held[N];
+
+  /**
+   * Number of entries of `held` in use. Read and written only by the
+   * owning thread.
+   */
+  uint16_t depth;
+
+  /**
+   * Number of readers-writer locks held by the thread, for read or write.
+   * Read and written only by the owning thread.
+   */
+  uint16_t nheld;
+
+  /**
+   * For each lock held, in the order obtained, bit set if it is a read
+   * registered in `held`, rather than a read in the shared count of the
+   * lock or a write. Locks are released in the reverse order, so that this
+   * distinguishes the two kinds of read when the same lock is read in a
+   * nested fashion. Read and written only by the owning thread.
+   */
+  uint32_t mask;
+};
+
+/**
+ * Get the read registrations of a thread.
+ *
+ * @param tid Thread number.
+ *
+ * @ingroup libbirch
+ */
+inline ReaderSlots& reader_slots(const int tid) {
+  static char* slots = [] {
+    static_assert(sizeof(ReaderSlots) <= 64, "ReaderSlots exceeds cache line");
+    auto n = get_max_slots();
+    auto raw = reinterpret_cast<std::uintptr_t>(new char[(n + 1)*64]);
+    auto slots = reinterpret_cast<char*>((raw + 63) & ~std::uintptr_t(63));
+    for (int i = 0; i < n; ++i) {
+      new (slots + i*64) ReaderSlots();
+    }
+    return slots;
+  }();
+  return *reinterpret_cast<ReaderSlots*>(slots + tid*64);
+}
+
 /**
  * Lock allowing multiple readers but only one writer.
  *
+ * While the lock is *biased* toward readers, a read is registered in the
+ * ReaderSlots of the calling thread rather than in the lock itself, so that
+ * concurrent readers do not contend on the cache line of the lock. A writer
+ * revokes the bias and then scans the slots of all threads for outstanding
+ * reads. After a revocation, reads use a shared count in the lock, until
+ * enough of them have been made that the bias is restored. This follows
+ * the BRAVO scheme of Dice & Kogan (2019), but with the visible readers
+ * table indexed by thread rather than hashed.
+ *
+ * The lock prefers writers: once a writer has claimed it, new readers wait
+ * until that writer has been and gone, rather than overtaking it
+ * indefinitely. The exception is a thread that already holds a
+ * readers-writer lock, of any kind on any lock, which may be a nested read
+ * of this same lock; making it wait could deadlock, so it proceeds as soon
+ * as no writer is in the critical region.
+ *
+ * Locks must be released in the reverse order to that in which they were
+ * obtained, i.e. last in, first out, across all readers-writer locks held by
+ * a thread. The thread records only how many locks it holds and, for each
+ * position in that stack, whether the lock at that position is a read
+ * registered in its slots (see ReaderSlots). A release consults the top of
+ * the stack, so that releasing out of order would release the wrong kind of
+ * read, and corrupt the count of the lock or the slots of the thread.
+ *
+ * Waiting readers and writers spin with exponential backoff, eventually
+ * yielding (see Backoff).
+ *
  * @ingroup libbirch
  */
 class ReadersWriterLock {
@@ -23,8 +121,11 @@ public:
    * Correctly initialize after a bitwise copy.
    */
   void bitwiseFix() {
-    readers.store(0u);
-    writer.store(false);
+    readers.store(0u, std::memory_order_relaxed);
+    writer.store(false, std::memory_order_relaxed);
+    pending.store(false, std::memory_order_relaxed);
+    bias.store(true, std::memory_order_relaxed);
+    inhibit.store(0, std::memory_order_relaxed);
   }
 
   /**
@@ -33,7 +134,8 @@ public:
   void setRead();
 
   /**
-   * Release read use.
+   * Release read use. This must be the lock most recently obtained, and not
+   * yet released, by the calling thread.
    */
   void unsetRead();
 
@@ -43,7 +145,8 @@ public:
   void setWrite();
 
   /**
-   * Release exclusive use.
+   * Release exclusive use. This must be the lock most recently obtained, and
+   * not yet released, by the calling thread.
    */
   void unsetWrite();
 
@@ -55,55 +158,169 @@ public:
 
 private:
   /**
-   * Number of readers in critical region.
+   * Is there a read of this lock registered in the slots of any thread?
+   */
+  bool slotted() const;
+
+  /**
+   * Number of reads, after a revocation of the bias, before it is restored.
+   * This has no out-of-class definition, so is passed by value, not by
+   * reference, to Atomic::store().
+   */
+  static constexpr int INHIBIT = 256;
+
+  /**
+   * Number of readers in critical region, other than those registered in
+   * thread slots.
    */
   Atomic<unsigned> readers;
 
+  /**
+   * Number of reads remaining before the bias is restored.
+   */
+  Atomic<int> inhibit;
+
   /**
    * Is there a writer in the critical region?
    */
   Atomic<bool> writer;
+
+  /**
+   * Has a writer claimed the lock? It remains claimed while the writer
+   * waits for readers to leave the critical region, and while the writer
+   * is in it.
+   */
+  Atomic<bool> pending;
+
+  /**
+   * Are readers to register in thread slots?
+   */
+  Atomic<bool> bias;
 };
 }
 
 inline libbirch::ReadersWriterLock::ReadersWriterLock() :
     readers(0),
-    writer(false) {
+    inhibit(0),
+    writer(false),
+    pending(false),
+    bias(true) {
   //
 }
 
 inline void libbirch::ReadersWriterLock::setRead() {
+  auto& slots = reader_slots(get_thread_num());
+  if (slots.depth < ReaderSlots::N && slots.nheld < ReaderSlots::M &&
+      bias.load(std::memory_order_relaxed)) {
+    /* register in the slot, then confirm that the bias has not been revoked
+     * in the meantime; a writer revokes the bias before scanning the slots,
+     * so either it sees the registration or this sees the revocation */
+    slots.held[slots.depth].store(this);
+    if (bias.load()) {
+      slots.mask |= 1u << slots.nheld;
+      ++slots.depth;
+      ++slots.nheld;
+      return;
+    }
+    slots.held[slots.depth].store(nullptr, std::memory_order_relaxed);
+  }
+
+  /* a thread holding no other lock defers to a writer that has claimed this
+   * one, while a thread holding another lock only waits on a writer in the
+   * critical region, see class documentation */
+  bool nested = slots.nheld > 0;
   readers.increment();
-  while (writer.load()) {
-    //
+  while (writer.load() || (!nested && pending.load())) {
+    readers.decrement();
+    Backoff backoff;
+    do {
+      backoff.pause();
+    } while (writer.load(std::memory_order_relaxed) ||
+        (!nested && pending.load(std::memory_order_relaxed)));
+    readers.increment();
+  }
+  ++slots.nheld;
+  if (inhibit.exchangeSub(1, std::memory_order_relaxed) == 1 &&
+      !pending.load(std::memory_order_relaxed)) {
+    /* while a read is held no writer can be in the critical region, so it
+     * is safe to restore the bias here; it is not restored while a writer
+     * waits, as that writer would then wait on new readers in slots too */
+    bias.store(true);
   }
 }
 
 inline void libbirch::ReadersWriterLock::unsetRead() {
-  readers.decrement();
+  auto& slots = reader_slots(get_thread_num());
+  --slots.nheld;
+  if (slots.nheld < ReaderSlots::M && (slots.mask >> slots.nheld) & 1u) {
+    slots.mask &= ~(1u << slots.nheld);
+    --slots.depth;
+    assert(slots.held[slots.depth].load(std::memory_order_relaxed) == this);
+    slots.held[slots.depth].store(nullptr, std::memory_order_release);
+  } else {
+    readers.decrement();
+  }
 }
 
 inline void libbirch::ReadersWriterLock::setWrite() {
-  bool w;
-  do {
-    /* obtain the write lock */
-    while (writer.exchange(true));
-
-    /* check if there are any readers; if so release the write lock to
-     * let those readers proceed and avoid a deadlock situation, repeating
-     * from the start, otherwise proceed */
-    w = (readers.load() == 0);
-    if (!w) {
-      writer.store(false);
+  /* claim the lock, to the exclusion of other writers and of new readers,
+   * and revoke the bias, so that new readers use the shared count; those
+   * already registered in slots must then be waited on */
+  Backoff backoff;
+  while (pending.load(std::memory_order_relaxed) || pending.exchange(true)) {
+    backoff.pause();
+  }
+  bool scan = bias.load();
+  if (scan) {
+    bias.store(false);
+    inhibit.store(int(INHIBIT), std::memory_order_relaxed);
+  }
+
+  /* wait for readers to leave the critical region; the writer flag is set
+   * before the shared count is checked, while readers increment the count
+   * before checking the flag, so that either this sees the reader or the
+   * reader sees this; the bias is checked again once the count is seen to
+   * be zero, as a reader using the shared count may have restored it */
+  backoff = Backoff();
+  while (true) {
+    writer.store(true);
+    if (readers.load() == 0) {
+      if (bias.load()) {
+        bias.store(false);
+        inhibit.store(int(INHIBIT), std::memory_order_relaxed);
+        scan = true;
+      }
+      if (!scan || !slotted()) {
+        break;
+      }
     }
-  } while (!w);
+    writer.store(false);
+    backoff.pause();
+  }
+  ++reader_slots(get_thread_num()).nheld;
 }
 
 inline void libbirch::ReadersWriterLock::unsetWrite() {
+  --reader_slots(get_thread_num()).nheld;
   writer.store(false);
+  pending.store(false);
 }
 
 inline void libbirch::ReadersWriterLock::downgrade() {
   readers.increment();
   writer.store(false);
+  pending.store(false);
+}
+
+inline bool libbirch::ReadersWriterLock::slotted() const {
+  auto nslots = get_max_slots();
+  for (int tid = 0; tid < nslots; ++tid) {
+    auto& slots = reader_slots(tid);
+    for (int i = 0; i < ReaderSlots::N; ++i) {
+      if (slots.held[i].load() == this) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
@@ -5,6 +5,7 @@
 
 #include "libbirch/external.hpp"
 #include "libbirch/Lock.hpp"
+#include "libbirch/Backoff.hpp"
 
 namespace libbirch {
 /**
@@ -43,7 +44,12 @@ public:
    */
   void acquire() {
     lock.set();
-    while (count.load() == 0u);
+    if (count.load() == 0u) {
+      Backoff backoff;
+      do {
+        backoff.pause();
+      } while (count.load() == 0u);
+    }
     --count;
     lock.unset();
   }
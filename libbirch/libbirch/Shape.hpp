@@ -101,8 +101,11 @@ struct EmptyShape {
  */
 template<class Head, class Tail>
 struct Shape {
+  typedef Head head_type;
+  typedef Tail tail_type;
+
   /**
-   * Default constructor (for zero-size shape).
+   * Default constructor (for zero-size shape, unless static).
    */
   Shape() {
     //
@@ -132,6 +135,18 @@ struct Shape {
    */
   Shape(const Shape<Head,Tail>& o) = default;
 
+  /**
+   * Generic copy constructor. This converts between static and dynamic
+   * shapes; for static lengths, those of @p o must match or an error is
+   * given.
+   */
+  template<class Head1, class Tail1>
+  Shape(const Shape<Head1,Tail1>& o) :
+      head(o.head),
+      tail(o.tail) {
+    //
+  }
+
   /**
    * Slice operator.
    */
@@ -300,4 +315,25 @@ template<>
 struct DefaultShape<0> {
   typedef EmptyShape type;
 };
+
+/**
+ * Static shape with the given lengths, all positive, and contiguous storage
+ * in row-major order. As the lengths and strides are known at compile time,
+ * Eigen can use fixed-size types for arrays of such shapes (see
+ * eigen_type).
+ */
+template<int64_t... lengths>
+struct StaticShape;
+template<int64_t length, int64_t... lengths>
+struct StaticShape<length,lengths...> {
+  static_assert(length > 0, "static lengths must be positive");
+  static const int64_t volume = length*StaticShape<lengths...>::volume;
+  typedef Shape<Dimension<length,StaticShape<lengths...>::volume>,
+      typename StaticShape<lengths...>::type> type;
+};
+template<>
+struct StaticShape<> {
+  static const int64_t volume = 1;
+  typedef EmptyShape type;
+};
 }
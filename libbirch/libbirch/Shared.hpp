@@ -41,7 +41,7 @@ public:
     if (ptr) {
       ptr->incShared();
     }
-    this->ptr.store(ptr);
+    this->ptr.store(ptr, std::memory_order_relaxed);
   }
 
   /**
@@ -53,7 +53,7 @@ public:
     if (ptr) {
       ptr->incShared();
     }
-    this->ptr.store(ptr);
+    this->ptr.store(ptr, std::memory_order_relaxed);
   }
 
   /**
@@ -65,14 +65,14 @@ public:
     if (ptr) {
       ptr->incShared();
     }
-    this->ptr.store(ptr);
+    this->ptr.store(ptr, std::memory_order_relaxed);
   }
 
   /**
    * Move constructor.
    */
   Shared(Shared&& o) {
-    ptr.store(o.ptr.exchange(nullptr));
+    ptr.store(o.ptr.exchange(nullptr), std::memory_order_relaxed);
   }
 
   /**
@@ -80,7 +80,7 @@ public:
    */
   template<class U, std::enable_if_t<std::is_base_of<T,U>::value,int> = 0>
   Shared(Shared<U>&& o) {
-    ptr.store(o.ptr.exchange(nullptr));
+    ptr.store(o.ptr.exchange(nullptr), std::memory_order_relaxed);
   }
 
   /**
@@ -135,8 +135,6 @@ public:
     if (old) {
       if (ptr == old) {
         old->decSharedReachable();
-      } else if (is_acyclic<Shared<T>>::value) {
-        old->decSharedAcyclic();
       } else {
         old->decShared();
       }
@@ -154,8 +152,6 @@ public:
     if (old) {
       if (ptr == old) {
         old->decSharedReachable();
-      } else if (is_acyclic<Shared<T>>::value) {
-        old->decSharedAcyclic();
       } else {
         old->decShared();
       }
@@ -191,8 +187,6 @@ public:
     if (old) {
       if (ptr == old) {
         old->decSharedReachable();
-      } else if (is_acyclic<Shared<T>>::value) {
-        old->decSharedAcyclic();
       } else {
         old->decShared();
       }
@@ -205,11 +199,7 @@ public:
   void release() {
     auto old = ptr.exchange(nullptr);
     if (old) {
-      if (is_acyclic<Shared<T>>::value) {
-        old->decSharedAcyclic();
-      } else {
-        old->decShared();
-      }
+      old->decShared();
     }
   }
 
@@ -231,12 +221,10 @@ public:
    * Mark.
    */
   void mark() {
-    if (!is_acyclic<Shared<T>>::value) {
-      auto o = ptr.load();
-      if (o) {
-        o->decSharedReachable();  // break the reference
-        o->Any::mark();
-      }
+    auto o = ptr.load();
+    if (o && !o->isSkipped()) {
+      o->decSharedReachable();  // break the reference
+      o->Any::mark();
     }
   }
 
@@ -244,11 +232,9 @@ public:
    * Scan.
    */
   void scan() {
-    if (!is_acyclic<Shared<T>>::value) {
-      auto o = ptr.load();
-      if (o) {
-        o->Any::scan();
-      }
+    auto o = ptr.load();
+    if (o && !o->isSkipped()) {
+      o->Any::scan();
     }
   }
 
@@ -256,12 +242,10 @@ public:
    * Reach.
    */
   void reach() {
-    if (!is_acyclic<Shared<T>>::value) {
-      auto o = ptr.load();
-      if (o) {
-        o->incShared();  // restore the broken reference
-        o->Any::reach();
-      }
+    auto o = ptr.load();
+    if (o && !o->isSkipped()) {
+      o->incShared();  // restore the broken reference
+      o->Any::reach();
     }
   }
 
@@ -269,12 +253,13 @@ public:
    * Collect.
    */
   void collect() {
-    if (!is_acyclic<Shared<T>>::value) {
-      auto o = ptr.exchange(nullptr);  // reference still broken, just set null
-      if (o) {
-        o->Any::collect();
-      }
+    auto o = ptr.load();
+    if (o && !o->isSkipped()) {
+      ptr.store(nullptr);  // reference still broken, just set null
+      o->Any::collect();
     }
+    // ^ a reference to a skipped object was never broken, and is released
+    //   as usual when the object is destroyed
   }
 
 private:
@@ -296,13 +281,9 @@ struct is_pointer<Shared<T>> {
 
 template<class T, unsigned N>
 struct is_acyclic<Shared<T>,N> {
-  // because pointers are polymorphic, the class must be both final and
-  // acyclic for the pointer to be considered acyclic
-  static const bool value = std::is_final<T>::value && is_acyclic_class<T,N-1>::value;
-};
-
-template<class T>
-struct is_acyclic<Shared<T>,0> {
+  // even if the class is final and acyclic, the object may be a copy,
+  // linked into a cycle through its label, which is only known at run time
+  // (see Any::setAcyclic())
   static const bool value = false;
 };
 
@@ -21,6 +21,17 @@
  * Declare common functions for classes.
  */
 #define LIBBIRCH_COMMON(Name, Base...) \
+  void* operator new(std::size_t size) { \
+    if (libbirch::memory_stats) { \
+      libbirch::count_object(#Name, 1); \
+    } \
+    return libbirch::allocate(size); \
+  } \
+  \
+  void operator delete(void* ptr) { \
+    libbirch::Any::operator delete(ptr); \
+  } \
+  \
   virtual const char* getClassName() const { \
     return #Name; \
   } \
@@ -39,6 +50,9 @@
   \
   virtual Name* copy_(libbirch::Label* label) const override { \
     auto src = static_cast<const void*>(this); \
+    if (libbirch::memory_stats) { \
+      libbirch::count_object(#Name, 1); \
+    } \
     auto dst = libbirch::allocate(sizeof(*this)); \
     std::memcpy(dst, src, sizeof(*this)); \
     auto o = static_cast<Name*>(dst); \
@@ -49,6 +49,13 @@
  * For this reason, LibBirch provides the cycle collection algorithm after
  * @ref Bacon2001 "Bacon & Rajan (2001)", with some minor adaptations.
  *
+ * ## Biased reference counting
+ *
+ * Most objects are only used by the thread that created them. Reference
+ * counts are biased toward that thread after @ref Choi2018
+ * "Choi, Shull & Torrellas (2018)", so that it updates them without atomic
+ * read-modify-write operations; see Any.
+ *
  * ## References
  *
  * @anchor Murray2020
@@ -59,4 +66,10 @@
  * D.F. Bacon and V.T. Rajan (2001). [Concurrent Cycle Collection in
  * Reference Counted Systems](https://dx.doi.org/10.1007/3-540-45337-7_12).
  * *ECOOP 2001 --- Object-Oriented Programming*. 207--235.
+ *
+ * @anchor Choi2018
+ * J. Choi, T. Shull and J. Torrellas (2018). [Biased Reference
+ * Counting](https://dx.doi.org/10.1145/3243176.3243195). *PACT '18:
+ * Proceedings of the 27th International Conference on Parallel Architectures
+ * and Compilation Techniques*.
  */
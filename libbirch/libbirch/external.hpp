@@ -11,6 +11,8 @@
 #include <utility>
 #include <functional>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <memory>
 #include <string>
 #include <sstream>
@@ -25,6 +27,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <dlfcn.h>
+#include <sys/mman.h>
 
 #include <eigen3/Eigen/Dense>
 
@@ -10,6 +10,7 @@
 #include "libbirch/assert.hpp"
 #include "libbirch/thread.hpp"
 #include "libbirch/memory.hpp"
+#include "libbirch/profile.hpp"
 #include "libbirch/stacktrace.hpp"
 #include "libbirch/class.hpp"
 #include "libbirch/type.hpp"
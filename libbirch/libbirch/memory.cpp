@@ -5,57 +5,545 @@
 
 #include "libbirch/Atomic.hpp"
 #include "libbirch/Pool.hpp"
+#include "libbirch/Lock.hpp"
 #include "libbirch/Any.hpp"
 #include "libbirch/Label.hpp"
 #include "libbirch/Shared.hpp"
 
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef ENABLE_NUMA
+#include <numa.h>
+#include <numaif.h>
+#include <sched.h>
+#endif
+
 /**
  * Type for object lists in cycle collection.
  */
 using object_list = std::vector<libbirch::Any*,libbirch::Allocator<libbirch::Any*>>;
 
+/**
+ * Get the possible roots list for the `i`th thread.
+ */
+static object_list& get_possible_roots(const int i) {
+  static std::vector<object_list,libbirch::Allocator<object_list>> objects(
+      libbirch::get_max_slots());
+  return objects[i];
+}
+
 /**
  * Get the possible roots list for the current thread.
  */
 static object_list& get_thread_possible_roots() {
+  return get_possible_roots(libbirch::get_thread_num());
+}
+
+/**
+ * Get the unreachable list for the `i`th thread.
+ */
+static object_list& get_unreachable(const int i) {
   static std::vector<object_list,libbirch::Allocator<object_list>> objects(
       libbirch::get_max_threads());
-  return objects[libbirch::get_thread_num()];
+  return objects[i];
 }
 
 /**
  * Get the unreachable list for the current thread.
  */
 static object_list& get_thread_unreachable() {
+  return get_unreachable(libbirch::get_thread_num());
+}
+
+/**
+ * Get the list of possible roots in the old generation, set aside until the
+ * next full collection, for the `i`th thread.
+ */
+static object_list& get_tenured(const int i) {
   static std::vector<object_list,libbirch::Allocator<object_list>> objects(
       libbirch::get_max_threads());
-  return objects[libbirch::get_thread_num()];
+  return objects[i];
 }
 
 /**
- * Make the heap.
+ * Get the list of objects to promote to the old generation at the end of
+ * the current collection, for the `i`th thread.
  */
-static char* make_heap() {
-  #ifdef DISABLE_MEMORY_POOL
-  return nullptr;
-  #else
-  /* determine a preferred size of the heap based on total physical memory */
-  size_t size = sysconf(_SC_PAGE_SIZE);
-  size_t npages = sysconf(_SC_PHYS_PAGES);
-  size_t n = 8u*npages*size;
+static object_list& get_promotions(const int i) {
+  static std::vector<object_list,libbirch::Allocator<object_list>> objects(
+      libbirch::get_max_threads());
+  return objects[i];
+}
 
-  /* attempt to allocate this amount, successively halving until
-   * successful */
-  void* ptr = nullptr;
-  int res = 0;
-  do {
-    res = posix_memalign(&ptr, 64ull, n);
-    n >>= 1;
-  } while (res > 0 && n > 0u);
-  assert(ptr);
+/**
+ * Type for lists of visits in cycle collection. Each visit is the address of
+ * an object, with the operation (a libbirch::Visit) in its two low bits.
+ */
+using visit_list = std::vector<uintptr_t,libbirch::Allocator<uintptr_t>>;
 
-  return (char*)ptr;
-  #endif
+/**
+ * Number of visits in each chunk of a frontier that can be stolen.
+ */
+static const size_t VISIT_CHUNK = 64;
+
+/**
+ * Frontier of visits of a thread in cycle collection. The thread pushes and
+ * pops visits at the back of its own list; once that list grows to two
+ * chunks, the older chunk is moved to a deque from which other threads, once
+ * out of work, may steal.
+ */
+struct frontier {
+  /**
+   * Visits, used only by the owning thread.
+   */
+  visit_list visits;
+
+  /**
+   * Chunks of visits that may be stolen.
+   */
+  std::vector<visit_list,libbirch::Allocator<visit_list>> chunks;
+
+  /**
+   * Lock for chunks.
+   */
+  libbirch::Lock lock;
+};
+
+/**
+ * Get the frontier for the `i`th thread.
+ */
+static frontier& get_frontier(const int i) {
+  static std::vector<frontier,libbirch::Allocator<frontier>> frontiers(
+      libbirch::get_max_threads());
+  return frontiers[i];
+}
+
+/**
+ * List of objects registered with a thread to merge their biased counts.
+ * Unlike the possible roots and unreachable lists, this is pushed to by other
+ * threads, and so has a lock.
+ */
+struct merge_list {
+  /**
+   * Objects.
+   */
+  object_list objects;
+
+  /**
+   * Lock.
+   */
+  libbirch::Lock lock;
+};
+
+/**
+ * Get the merge list for the `i`th thread.
+ */
+static merge_list& get_merges(const int i) {
+  static std::vector<merge_list,libbirch::Allocator<merge_list>> merges(
+      libbirch::get_max_threads());
+  return merges[i];
+}
+
+/**
+ * Merge the biased counts of the objects registered with the `i`th thread by
+ * other threads; this may destroy some, and register others as possible
+ * roots. This must be called by that thread, or by the master thread while
+ * that thread is idle.
+ */
+static void merge_registered(const int i) {
+  auto& merges = get_merges(i);
+  merges.lock.set();
+  object_list objects;
+  objects.swap(merges.objects);
+  merges.lock.unset();
+  for (auto& o : objects) {
+    if (!o->isDestroyed()) {
+      o->merge();
+    }
+    o->decMemo();
+  }
+}
+
+/**
+ * Number of possible roots processed by each thread in each slice of an
+ * incremental cycle collection, i.e. when a slice budget is set.
+ */
+static const size_t COLLECT_SLICE = 1024;
+
+/**
+ * Slice budget for cycle collection, in seconds, or zero for no budget. No
+ * further slice is started once it is exhausted.
+ */
+static double collect_slice_budget = 0.0;
+
+/**
+ * Is automatic cycle collection enabled? This, and the thresholds and flag
+ * below that are read on registration of a possible root, are atomic, as
+ * the background thread of the collector may register possible roots while
+ * the master thread updates them.
+ */
+static libbirch::Atomic<bool> collect_auto(false);
+
+/**
+ * Minimum threshold on the number of possible roots for automatic cycle
+ * collection.
+ */
+static const size_t MIN_COLLECT_ROOTS = 1ull << 16ull;
+
+/**
+ * Minimum threshold on the growth of the heap, in bytes, for automatic
+ * cycle collection.
+ */
+static const size_t MIN_COLLECT_BYTES = 1ull << 26ull;
+
+/**
+ * Threshold on the number of possible roots, across all threads, at which
+ * a cycle collection becomes due. This adapts to the yield of collections:
+ * it doubles after a collection that destroys few objects relative to the
+ * number of possible roots processed, and halves, to no lower than
+ * MIN_COLLECT_ROOTS, after one that destroys many.
+ */
+static libbirch::Atomic<size_t> collect_roots(MIN_COLLECT_ROOTS);
+
+/**
+ * Threshold on the growth of the heap, in bytes, across all threads, since
+ * the last cycle collection, at which a cycle collection becomes due. This
+ * adapts to the size of the heap after each collection, so that a
+ * collection becomes due when the heap would double.
+ */
+static libbirch::Atomic<size_t> collect_bytes(MIN_COLLECT_BYTES);
+
+/**
+ * Is the cycle collector in concurrent mode?
+ */
+static bool collect_concurrent = false;
+
+/**
+ * Number of collections in each period of generational collection, of
+ * which the last is a full collection and the rest are minor.
+ */
+static const int COLLECT_FULL_PERIOD = 8;
+
+/**
+ * Number of minor collections since the last full collection.
+ */
+static int nminor = 0;
+
+/**
+ * Is a cycle collection in progress? While it is, the lists of possible
+ * roots are indexed by the collector, and are not compacted.
+ */
+static libbirch::Atomic<bool> collecting(false);
+
+/**
+ * Minimum capacity of a list of possible roots before it is compacted.
+ */
+static const size_t MIN_COMPACT_ROOTS = 1ull << 10ull;
+
+/**
+ * Compact a list of possible roots, removing any objects that are no
+ * longer possible roots, such as those destroyed since registration, and
+ * releasing the memo count held for each.
+ */
+static void compact(object_list& possible_roots) {
+  auto first = possible_roots.begin();
+  auto last = possible_roots.end();
+  auto to = first;
+  for (auto from = first; from != last; ++from) {
+    auto o = *from;
+    if (o->isPossibleRoot()) {
+      *to = o;
+      ++to;
+    } else {
+      o->decMemo();
+    }
+  }
+  possible_roots.erase(to, last);
+}
+
+/**
+ * Make room in a list of possible roots for one more, either by compacting
+ * it or, if it is not yet worth compacting, letting it grow.
+ */
+static void make_room(object_list& possible_roots) {
+  if (possible_roots.size() == possible_roots.capacity() &&
+      possible_roots.size() >= MIN_COMPACT_ROOTS) {
+    /* compact rather than grow, unless that would leave the list more than
+     * half full, in which case grow anyway, so that the cost of compaction
+     * is amortized over at least as many registrations as it inspects */
+    compact(possible_roots);
+    if (2*possible_roots.size() > possible_roots.capacity()) {
+      possible_roots.reserve(2*possible_roots.capacity());
+    }
+  }
+}
+
+/**
+ * Background thread of the cycle collector. In concurrent mode, a
+ * collection identifies the unreachable objects as usual, but leaves them in
+ * the unreachable lists of the threads, and hands these to this thread to
+ * destroy while the mutator continues. Only this sweep is concurrent; the
+ * merge, mark, scan and collect phases stop the world as usual.
+ *
+ * The objects are unreachable, so the mutator cannot touch them; at most it
+ * reads their flags, and reduces their memo counts, as keys of memos, both
+ * atomically. The next collection waits for the sweep to finish before it
+ * starts, so that objects are never visited while being destroyed, and the
+ * lists are never shared. Destroying objects may register others as
+ * possible roots, in the list of this thread, so that the settings read on
+ * registration are atomic, and the time of the sweep is recorded in the
+ * statistics of this thread, not those of the collection.
+ */
+struct Sweeper {
+  /**
+   * Thread.
+   */
+  std::thread thread;
+
+  /**
+   * Mutex for the fields below.
+   */
+  std::mutex mutex;
+
+  /**
+   * Condition on which both threads wait for a change in the fields below.
+   */
+  std::condition_variable changed;
+
+  /**
+   * Is there a sweep pending or in progress?
+   */
+  bool pending = false;
+
+  /**
+   * Has the thread been asked to stop?
+   */
+  bool stop = false;
+};
+
+/**
+ * Get the sweeper. It is never destroyed, as it may be needed until the
+ * very end of the program.
+ */
+static Sweeper& sweeper() {
+  static Sweeper* sweeper = new Sweeper();
+  return *sweeper;
+}
+
+/**
+ * Cycle collector statistics. Times are wall-clock times in seconds, as
+ * observed by the master thread, and include the wait at the barrier that
+ * ends each phase.
+ */
+struct CollectorStats {
+  /**
+   * Number of calls to collect().
+   */
+  int64_t ncollections;
+
+  /**
+   * Number of those collections that were full collections.
+   */
+  int64_t nfull;
+
+  /**
+   * Number of slices of possible roots processed.
+   */
+  int64_t nslices;
+
+  /**
+   * Number of possible roots processed.
+   */
+  int64_t nroots;
+
+  /**
+   * Number of possible roots left for a later collection when the budget
+   * was exhausted.
+   */
+  int64_t ndeferred;
+
+  /**
+   * Number of objects destroyed.
+   */
+  int64_t ndestroyed;
+
+  /**
+   * Time merging biased counts.
+   */
+  double merge;
+
+  /**
+   * Time marking.
+   */
+  double mark;
+
+  /**
+   * Time scanning.
+   */
+  double scan;
+
+  /**
+   * Time collecting.
+   */
+  double collect;
+
+  /**
+   * Time destroying unreachable objects.
+   */
+  double destroy;
+
+  /**
+   * Time returning memory to the operating system.
+   */
+  double reclaim;
+
+  /**
+   * Total time in collect().
+   */
+  double total;
+
+  /**
+   * Longest time in a single call to collect().
+   */
+  double max;
+};
+
+/**
+ * Cycle collector statistics for a thread. These count the work performed
+ * by the thread.
+ */
+struct CollectorThreadStats {
+  /**
+   * Number of possible roots processed.
+   */
+  int64_t nroots;
+
+  /**
+   * Number of visits to the members of objects performed from the frontier,
+   * rather than immediately.
+   */
+  int64_t nvisits;
+
+  /**
+   * Number of chunks of visits stolen from other threads.
+   */
+  int64_t nsteals;
+
+  /**
+   * Time destroying unreachable objects, in seconds. Only the background
+   * thread of the collector, in concurrent mode, accumulates this.
+   */
+  double sweep;
+};
+
+/**
+ * Get the cycle collector statistics for a thread.
+ *
+ * @param tid Thread slot.
+ */
+static CollectorThreadStats& collector_thread_stats(const int tid) {
+  static CollectorThreadStats* stats =
+      new CollectorThreadStats[libbirch::get_max_slots()]();
+  return stats[tid];
+}
+
+/**
+ * Steal a chunk of visits from another thread.
+ *
+ * @param tid Id of the current thread.
+ * @param nbusy Number of threads with visits to perform, incremented if a
+ * chunk is stolen.
+ *
+ * @return Was a chunk stolen?
+ */
+static bool steal(const int tid, libbirch::Atomic<int>& nbusy) {
+  auto& f = get_frontier(tid);
+  auto nthreads = libbirch::get_max_threads();
+  for (int i = 1; i < nthreads; ++i) {
+    auto& victim = get_frontier((tid + i) % nthreads);
+    if (!victim.chunks.empty()) {  // racy check, confirmed below
+      victim.lock.set();
+      if (!victim.chunks.empty()) {
+        /* count as busy before the chunk leaves the deque, so that other
+         * threads do not see zero busy threads while work remains */
+        nbusy.increment();
+        f.visits.swap(victim.chunks.back());
+        victim.chunks.pop_back();
+        victim.lock.unset();
+        return true;
+      }
+      victim.lock.unset();
+    }
+  }
+  return false;
+}
+
+/**
+ * Perform the visits on the frontier of the current thread, and steal
+ * visits from other threads, until there are no visits left on any thread.
+ *
+ * @param nbusy Number of threads with visits to perform. The current thread
+ * must be counted in this on entry.
+ */
+static void drain(libbirch::Atomic<int>& nbusy) {
+  auto tid = libbirch::get_thread_num();
+  auto nthreads = libbirch::get_max_threads();
+  auto& f = get_frontier(tid);
+  auto& stats = collector_thread_stats(tid);
+  bool busy = true;
+  while (true) {
+    while (!f.visits.empty()) {
+      auto visit = f.visits.back();
+      f.visits.pop_back();
+      auto o = reinterpret_cast<libbirch::Any*>(visit & ~uintptr_t(3));
+      o->visit(libbirch::Visit(visit & uintptr_t(3)));
+      ++stats.nvisits;
+    }
+
+    /* take back a chunk moved to the deque, if any */
+    if (!f.chunks.empty()) {  // racy check, confirmed below
+      f.lock.set();
+      if (!f.chunks.empty()) {
+        f.visits.swap(f.chunks.back());
+        f.chunks.pop_back();
+      }
+      f.lock.unset();
+      if (!f.visits.empty()) {
+        continue;
+      }
+    }
+
+    /* otherwise steal, until no thread has visits left to perform */
+    if (busy) {
+      nbusy.decrement();
+      busy = false;
+    }
+    if (steal(tid, nbusy)) {
+      busy = true;
+      libbirch::hungry.store(false, std::memory_order_relaxed);
+      ++stats.nsteals;
+    } else if (nbusy.load() == 0) {
+      /* the next phase starts with all threads out of work */
+      libbirch::hungry.store(nthreads > 1, std::memory_order_relaxed);
+      break;
+    } else {
+      libbirch::hungry.store(true, std::memory_order_relaxed);
+      /* let busy threads run, if there are more threads than cores */
+      std::this_thread::yield();
+    }
+  }
+}
+
+/**
+ * Get the cycle collector statistics.
+ */
+static CollectorStats& collector_stats() {
+  static CollectorStats stats{0, 0, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+      0.0, 0.0};
+  return stats;
 }
 
 /**
@@ -65,51 +553,297 @@ static libbirch::Label* make_root() {
   return new libbirch::Label();
 }
 
+libbirch::Atomic<bool> libbirch::hungry(false);
+libbirch::Atomic<bool> libbirch::collect_due(false);
+bool libbirch::collect_generational = false;
+bool libbirch::collect_minor = false;
+__thread int libbirch::thread_slot = -1;
 libbirch::ExitBarrierLock libbirch::finish_lock;
 libbirch::ExitBarrierLock libbirch::freeze_lock;
+bool libbirch::memory_stats = false;
+
+/**
+ * Size of each chunk of the heap, in bytes. Chunks are aligned to this size,
+ * so that the chunk to which a block belongs can be found by masking the
+ * address of the block.
+ */
+static const size_t CHUNK_SIZE = 1ull << 21ull;
+
+/**
+ * Size of the header at the start of each chunk, in bytes. Blocks are
+ * aligned to at least 16 bytes, as the sizes of all bins are multiples of
+ * 16.
+ */
+static const size_t CHUNK_HEADER_SIZE = 64ull;
+
+/**
+ * Number of bins (size classes). The sizes of the bins are given by
+ * unbin().
+ */
+static const int NCLASSES = 1 + 4*(64 - 6);
+
+/**
+ * Largest bin served from chunks, which is that of 256KB. Allocations in
+ * larger bins are mapped directly from the operating system, and unmapped
+ * again on deallocation.
+ */
+static const int MAX_CHUNK_BIN = 48;
+
+/**
+ * Number of bins served from chunks. Each thread has a pool and magazine
+ * for each.
+ */
+static const int NBINS = MAX_CHUNK_BIN + 1;
+
+/**
+ * Chunk of the heap. Each chunk belongs to one thread, and is carved into
+ * blocks of the size of one bin, so that a chunk in which all blocks are
+ * free can be returned to the operating system.
+ */
+struct Chunk {
+  /**
+   * Next chunk in the list of chunks of the owning thread.
+   */
+  Chunk* next;
+
+  /**
+   * Next position from which to carve a block.
+   */
+  char* top;
+
+  /**
+   * Number of blocks carved from the chunk so far.
+   */
+  unsigned ncarved;
+
+  /**
+   * Number of blocks of the chunk found free during reclamation.
+   */
+  libbirch::Atomic<unsigned> nfree;
+
+  /**
+   * Bin of the blocks in the chunk.
+   */
+  int bin;
+};
+static_assert(sizeof(Chunk) <= CHUNK_HEADER_SIZE, "chunk header too large");
+
+/**
+ * Arena of chunks for a single thread.
+ */
+struct Arena {
+  /**
+   * Constructor.
+   */
+  Arena() :
+      chunks(nullptr),
+      nchunks(0),
+      ngrown(0) {
+    std::fill(current, current + NBINS, nullptr);
+  }
+
+  /**
+   * Chunk currently being carved, for each bin.
+   */
+  Chunk* current[NBINS];
+
+  /**
+   * List of all chunks of the thread.
+   */
+  Chunk* chunks;
+
+  /**
+   * Number of chunks in the list.
+   */
+  size_t nchunks;
+
+  /**
+   * Number of bytes mapped by the thread, for new chunks and large
+   * allocations, since the last cycle collection.
+   */
+  size_t ngrown;
+};
 
 /**
- * Get the heap.
+ * Get the arena for the `i`th thread.
  */
-inline libbirch::Atomic<char*>& heap() {
-  static libbirch::Atomic<char*> heap(make_heap());
-  return heap;
+inline Arena& arena(const int i) {
+  static Arena* arenas = new Arena[libbirch::get_max_slots()];
+  return arenas[i];
 }
 
 /**
- * Get the `i`th pool.
+ * Get the `i`th pool. The pools of a thread receive blocks deallocated by
+ * other threads.
  */
 inline libbirch::Pool& pool(const int i) {
   static libbirch::Pool* pools =
-      new libbirch::Pool[64*libbirch::get_max_threads()];
+      new libbirch::Pool[NBINS*libbirch::get_max_slots()];
   return pools[i];
 }
 
 /**
- * For an allocation size, determine the index of the pool to which it
- * belongs.
+ * Get the `i`th magazine. A magazine is a list of free blocks, linked as in
+ * Pool, that caches blocks for a single thread in front of its pool. It is
+ * only accessed by that thread, and so without atomic operations. Blocks
+ * deallocated by the thread that allocated them are returned to its
+ * magazine, and an empty magazine is refilled by taking the entire contents
+ * of the pool in one operation.
+ */
+inline void*& magazine(const int i) {
+  static void** magazines = new void*[NBINS*libbirch::get_max_slots()]();
+  return magazines[i];
+}
+
+/**
+ * Pop a block from a magazine. Returns `nullptr` if the magazine is empty.
+ */
+inline void* pop(void*& magazine) {
+  auto ptr = magazine;
+  if (ptr) {
+    magazine = libbirch::Pool::getNext(ptr);
+  }
+  return ptr;
+}
+
+/**
+ * Push a block to a magazine.
+ */
+inline void push(void*& magazine, void* ptr) {
+  libbirch::Pool::setNext(ptr, magazine);
+  magazine = ptr;
+}
+
+#ifdef ENABLE_MEMORY_STATS
+/**
+ * Statistics for a bin. These are kept per thread, and updated by the
+ * thread performing each operation without atomics, so that those of an
+ * individual thread may be negative where blocks are deallocated by a
+ * different thread to that which allocated them; only their sum across
+ * threads is meaningful.
+ */
+struct BinStats {
+  /**
+   * Number of blocks in use.
+   */
+  int64_t nlive;
+
+  /**
+   * Number of bytes requested for the blocks in use.
+   */
+  int64_t nrequested;
+
+  /**
+   * Number of blocks carved from chunks and not since returned to the
+   * operating system.
+   */
+  int64_t ncarved;
+};
+
+/**
+ * Get the statistics for a thread and bin.
+ *
+ * @param tid Thread id.
+ * @param i Bin.
+ */
+inline BinStats& bin_stats(const int tid, const int i) {
+  static BinStats* stats =
+      new BinStats[NCLASSES*libbirch::get_max_slots()]();
+  return stats[NCLASSES*tid + i];
+}
+
+/**
+ * Statistics for a thread. These count the operations performed by the
+ * thread.
+ */
+struct ThreadStats {
+  /**
+   * Number of allocations.
+   */
+  int64_t nallocations;
+
+  /**
+   * Number of deallocations.
+   */
+  int64_t ndeallocations;
+
+  /**
+   * Number of reallocations.
+   */
+  int64_t nreallocations;
+
+  /**
+   * Number of reallocations that moved to a new block, copying its contents.
+   */
+  int64_t ncopies;
+
+  /**
+   * Number of bytes copied by those reallocations.
+   */
+  int64_t ncopied;
+};
+
+/**
+ * Get the statistics for a thread.
+ *
+ * @param tid Thread id.
+ */
+inline ThreadStats& thread_stats(const int tid) {
+  static ThreadStats* stats =
+      new ThreadStats[libbirch::get_max_slots()]();
+  return stats[tid];
+}
+
+/**
+ * Type for counts of objects by class name.
+ */
+using class_counts = std::unordered_map<const char*,int64_t>;
+
+/**
+ * Get the counts of objects by class name for a thread. These are keyed by
+ * the pointer returned by Any::getClassName(), and merged by string when
+ * reported. As for BinStats, the count for an individual thread may be
+ * negative, where objects are destroyed by a different thread to that which
+ * created them.
+ *
+ * @param tid Thread id.
+ */
+inline class_counts& object_counts(const int tid) {
+  static class_counts* counts =
+      new class_counts[libbirch::get_max_slots()]();
+  return counts[tid];
+}
+#endif
+
+/**
+ * For an allocation size, determine the index of the size class (bin) to
+ * which it belongs.
  *
  * @param n Number of bytes.
  *
- * @return Pool index.
+ * @return Bin index.
  *
- * Pool sizes are multiples of 8 bytes up to 64 bytes, and powers of two
- * thereafter.
+ * The first bin is for sizes up to 64 bytes. Thereafter, each doubling of
+ * size is divided into four bins of equal spacing, e.g. 80, 96, 112, and 128
+ * bytes, then 160, 192, 224, and 256 bytes, and so on. This bounds internal
+ * fragmentation to 20%, rather than the 50% of power-of-two bins.
  */
 inline int bin(const size_t n) {
   assert(n > 0ull);
   int result = 0;
-  #ifdef HAVE___BUILTIN_CLZLL
   if (n > 64ull) {
-    /* __builtin_clzll undefined for zero argument */
-    result = 64 - __builtin_clzll((n - 1ull) >> 6ull);
-  }
-  #else
-  while (((n - 1ull) >> (6 + result)) > 0) {
-    ++result;
+    /* k such that 2^k < n <= 2^(k + 1) */
+    int k = 0;
+    #ifdef HAVE___BUILTIN_CLZLL
+    k = 63 - __builtin_clzll(n - 1ull);
+    #else
+    while (((n - 1ull) >> (k + 1)) > 0) {
+      ++k;
+    }
+    #endif
+    result = 1 + 4*(k - 6) + static_cast<int>(((n - 1ull) >> (k - 2)) & 3ull);
   }
-  #endif
-  assert(0 <= result && result <= 63);
+  assert(0 <= result && result < NCLASSES);
   return result;
 }
 
@@ -117,9 +851,230 @@ inline int bin(const size_t n) {
  * Determine the size for a given bin.
  */
 inline size_t unbin(const int i) {
-  return 64ull << i;
+  if (i == 0) {
+    return 64ull;
+  } else {
+    int k = 6 + (i - 1)/4;
+    size_t j = (i - 1) % 4 + 1;
+    return (1ull << k) + (j << (k - 2));
+  }
+}
+
+#ifdef ENABLE_NUMA
+/**
+ * Is this a NUMA system with more than one node?
+ */
+static bool is_numa() {
+  static const bool numa = numa_available() >= 0 &&
+      numa_num_configured_nodes() > 1;
+  return numa;
 }
 
+/**
+ * Set the policy for newly mapped memory to prefer the NUMA node of the
+ * calling thread. This is called before the memory is first touched, so that
+ * its pages are placed on that node regardless of which thread later touches
+ * them first. It is a preference rather than a binding, so that the memory
+ * falls back to other nodes when that node is exhausted.
+ *
+ * @param ptr Pointer to the mapped memory.
+ * @param n Number of bytes.
+ */
+static void prefer_local_node(void* ptr, const size_t n) {
+  int cpu = sched_getcpu();
+  int node = cpu >= 0 ? numa_node_of_cpu(cpu) : -1;
+  if (node >= 0) {
+    auto mask = numa_allocate_nodemask();
+    numa_bitmask_setbit(mask, node);
+    mbind(ptr, n, MPOL_PREFERRED, mask->maskp, mask->size + 1, 0);
+    numa_free_nodemask(mask);
+  }
+}
+#endif
+
+/**
+ * Map memory from the operating system.
+ *
+ * @param n Number of bytes.
+ *
+ * If LibBirch is configured with `--enable-numa`, and the system has more
+ * than one NUMA node, the memory is placed on the NUMA node of the calling
+ * thread. As chunks are mapped by the thread that carves them, each thread's
+ * heap is then local to it. On a system with one node, or without
+ * `--enable-numa`, placement is left to the operating system, which
+ * ordinarily places each page on the node of the thread that first touches
+ * it.
+ */
+static void* map(const size_t n) {
+  void* ptr = mmap(nullptr, n, PROT_READ|PROT_WRITE,
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  libbirch_error_msg_(ptr != MAP_FAILED, "out of memory allocating " << n <<
+      " bytes.");
+  #ifdef ENABLE_NUMA
+  if (is_numa()) {
+    prefer_local_node(ptr, n);
+  }
+  #endif
+  return ptr;
+}
+
+/**
+ * Unmap memory previously mapped with map().
+ *
+ * @param ptr Pointer to the mapped memory.
+ * @param n Number of bytes.
+ */
+static void unmap(void* ptr, const size_t n) {
+  munmap(ptr, n);
+}
+
+/**
+ * Make a new chunk.
+ *
+ * @param i Bin of the blocks in the chunk.
+ */
+static Chunk* make_chunk(const int i) {
+  /* overallocate, then trim to a chunk-aligned region */
+  auto raw = static_cast<char*>(map(2ull*CHUNK_SIZE));
+  auto ptr = reinterpret_cast<char*>((reinterpret_cast<size_t>(raw) +
+      CHUNK_SIZE - 1ull) & ~(CHUNK_SIZE - 1ull));
+  if (ptr > raw) {
+    unmap(raw, ptr - raw);
+  }
+  if (ptr + CHUNK_SIZE < raw + 2ull*CHUNK_SIZE) {
+    unmap(ptr + CHUNK_SIZE, raw + 2ull*CHUNK_SIZE - (ptr + CHUNK_SIZE));
+  }
+
+  auto chunk = new (ptr) Chunk();
+  chunk->next = nullptr;
+  chunk->top = ptr + CHUNK_HEADER_SIZE;
+  chunk->ncarved = 0u;
+  chunk->nfree.store(0u);
+  chunk->bin = i;
+  return chunk;
+}
+
+/**
+ * Get the chunk to which a block belongs.
+ */
+inline Chunk* chunk_of(void* ptr) {
+  return reinterpret_cast<Chunk*>(reinterpret_cast<size_t>(ptr) &
+      ~(CHUNK_SIZE - 1ull));
+}
+
+/**
+ * Note growth of the heap by a thread, flagging a cycle collection as due if
+ * the growth since the last exceeds the threshold.
+ *
+ * @param a Arena of the thread.
+ * @param n Number of bytes.
+ */
+static void grow(Arena& a, const size_t n) {
+  a.ngrown += n;
+  if (collect_auto.load(std::memory_order_relaxed) && a.ngrown >=
+      collect_bytes.load(std::memory_order_relaxed)/
+      libbirch::get_max_threads()) {
+    libbirch::collect_due.store(true, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * Carve a new block from the current chunk of a thread, starting a new chunk
+ * if necessary.
+ *
+ * @param tid Thread id.
+ * @param i Bin.
+ * @param m Block size for the bin.
+ */
+static void* carve(const int tid, const int i, const size_t m) {
+  auto& a = arena(tid);
+  auto chunk = a.current[i];
+  if (!chunk || chunk->top + m > reinterpret_cast<char*>(chunk) + CHUNK_SIZE) {
+    chunk = make_chunk(i);
+    chunk->next = a.chunks;
+    a.chunks = chunk;
+    a.current[i] = chunk;
+    ++a.nchunks;
+    grow(a, CHUNK_SIZE);
+  }
+  auto ptr = chunk->top;
+  chunk->top += m;
+  ++chunk->ncarved;
+  #ifdef ENABLE_MEMORY_STATS
+  ++bin_stats(tid, i).ncarved;
+  #endif
+  return ptr;
+}
+
+#if defined(ENABLE_MEMORY_RECLAIM) && !defined(DISABLE_MEMORY_POOL)
+/**
+ * Return to the operating system all chunks in which every block is free.
+ * This must be called by all threads of the team simultaneously, and while
+ * no other allocations or deallocations are in progress.
+ *
+ * Free blocks are counted against their chunks in a first pass, as a block
+ * may be returned to the pool of a thread other than that which carved it.
+ * Blocks of fully-free chunks are then removed from the magazines and pools,
+ * and finally each thread unmaps its own fully-free chunks.
+ */
+static void reclaim() {
+  int tid = libbirch::get_thread_num();
+  void* lists[NBINS];
+
+  /* count free blocks, moving them all to the magazines */
+  for (int i = 0; i < NBINS; ++i) {
+    auto& m = magazine(NBINS*tid + i);
+    auto ptr = pool(NBINS*tid + i).popAll();
+    while (ptr) {
+      push(m, pop(ptr));
+    }
+    for (ptr = m; ptr; ptr = libbirch::Pool::getNext(ptr)) {
+      chunk_of(ptr)->nfree.increment();
+    }
+    lists[i] = m;
+    m = nullptr;
+  }
+  #pragma omp barrier
+
+  /* return blocks of chunks that are not fully free to the magazines */
+  for (int i = 0; i < NBINS; ++i) {
+    auto& m = magazine(NBINS*tid + i);
+    auto ptr = lists[i];
+    while (ptr) {
+      auto block = pop(ptr);
+      auto chunk = chunk_of(block);
+      if (chunk->nfree.load() < chunk->ncarved) {
+        push(m, block);
+      }
+    }
+  }
+  #pragma omp barrier
+
+  /* unmap fully-free chunks */
+  auto& a = arena(tid);
+  Chunk** prev = &a.chunks;
+  Chunk* chunk = a.chunks;
+  while (chunk) {
+    auto next = chunk->next;
+    if (chunk->nfree.load() == chunk->ncarved) {
+      if (a.current[chunk->bin] == chunk) {
+        a.current[chunk->bin] = nullptr;
+      }
+      *prev = next;
+      --a.nchunks;
+      #ifdef ENABLE_MEMORY_STATS
+      bin_stats(tid, chunk->bin).ncarved -= chunk->ncarved;
+      #endif
+      unmap(chunk, CHUNK_SIZE);
+    } else {
+      chunk->nfree.store(0u);
+      prev = &chunk->next;
+    }
+    chunk = next;
+  }
+}
+#endif
+
 libbirch::Label*& libbirch::root() {
   static Label* root(make_root());
   return root;
@@ -129,16 +1084,36 @@ void* libbirch::allocate(const size_t n) {
   assert(n > 0u);
 
   #ifdef DISABLE_MEMORY_POOL
+  if (n % 64u == 0u) {
+    /* keep the alignment that the pool gives to such sizes */
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, 64u, n) == 0 ? ptr : nullptr;
+  }
   return std::malloc(n);
   #else
   int tid = get_thread_num();
   int i = bin(n);       // determine which pool
-  auto ptr = pool(64*tid + i).pop();  // attempt to reuse from this pool
-  if (!ptr) {           // otherwise allocate new
-    size_t m = unbin(i);
-    ptr = (heap() += m) - m;
+  void* ptr = nullptr;
+  if (i > MAX_CHUNK_BIN) {  // large allocation, map directly
+    ptr = map(unbin(i));
+    grow(arena(tid), unbin(i));
+  } else {
+    auto& m = magazine(NBINS*tid + i);
+    if (!m) {           // refill the magazine from the pool, in bulk
+      m = pool(NBINS*tid + i).popAll();
+    }
+    ptr = pop(m);       // attempt to reuse from the magazine
+    if (!ptr) {         // otherwise allocate new
+      ptr = carve(tid, i, unbin(i));
+    }
   }
   assert(ptr);
+  #ifdef ENABLE_MEMORY_STATS
+  auto& stats = bin_stats(tid, i);
+  ++stats.nlive;
+  stats.nrequested += n;
+  ++thread_stats(tid).nallocations;
+  #endif
   return ptr;
   #endif
 }
@@ -146,13 +1121,25 @@ void* libbirch::allocate(const size_t n) {
 void libbirch::deallocate(void* ptr, const size_t n, const int tid) {
   assert(ptr);
   assert(n > 0u);
-  assert(tid < get_max_threads());
+  assert(tid < get_max_slots());
 
   #ifdef DISABLE_MEMORY_POOL
   std::free(ptr);
   #else
   int i = bin(n);
-  pool(64*tid + i).push(ptr);
+  #ifdef ENABLE_MEMORY_STATS
+  auto& stats = bin_stats(get_thread_num(), i);
+  --stats.nlive;
+  stats.nrequested -= n;
+  ++thread_stats(get_thread_num()).ndeallocations;
+  #endif
+  if (i > MAX_CHUNK_BIN) {
+    unmap(ptr, unbin(i));
+  } else if (tid == get_thread_num()) {
+    push(magazine(NBINS*tid + i), ptr);
+  } else {
+    pool(NBINS*tid + i).push(ptr);
+  }
   #endif
 }
 
@@ -160,7 +1147,7 @@ void* libbirch::reallocate(void* ptr1, const size_t n1, const int tid1,
     const size_t n2) {
   assert(ptr1);
   assert(n1 > 0u);
-  assert(tid1 < get_max_threads());
+  assert(tid1 < get_max_slots());
   assert(n2 > 0u);
 
   #ifdef DISABLE_MEMORY_POOL
@@ -169,6 +1156,10 @@ void* libbirch::reallocate(void* ptr1, const size_t n1, const int tid1,
   int i1 = bin(n1);
   int i2 = bin(n2);
   void* ptr2 = ptr1;
+  #ifdef ENABLE_MEMORY_STATS
+  auto& stats = thread_stats(get_thread_num());
+  ++stats.nreallocations;
+  #endif
   if (i1 != i2) {
     /* can't continue using current allocation */
     ptr2 = allocate(n2);
@@ -176,15 +1167,167 @@ void* libbirch::reallocate(void* ptr1, const size_t n1, const int tid1,
       std::memcpy(ptr2, ptr1, std::min(n1, n2));
     }
     deallocate(ptr1, n1, tid1);
+    #ifdef ENABLE_MEMORY_STATS
+    ++stats.ncopies;
+    stats.ncopied += std::min(n1, n2);
+    #endif
   }
+  #ifdef ENABLE_MEMORY_STATS
+  else {
+    bin_stats(get_thread_num(), i1).nrequested += int64_t(n2) - int64_t(n1);
+  }
+  #endif
   return ptr2;
   #endif
 }
 
+void libbirch::enable_memory_stats() {
+  #ifdef ENABLE_MEMORY_STATS
+  memory_stats = true;
+  #endif
+}
+
+void libbirch::count_object(const char* name, const int n) {
+  #ifdef ENABLE_MEMORY_STATS
+  object_counts(get_thread_num())[name] += n;
+  #endif
+}
+
+void libbirch::memory_report(std::ostream& out) {
+  #if defined(ENABLE_MEMORY_STATS) && !defined(DISABLE_MEMORY_POOL)
+  auto flags = out.flags();
+  auto precision = out.precision();
+
+  /* operations by thread */
+  out << std::setw(12) << "thread" << std::setw(16) << "allocations" <<
+      std::setw(16) << "deallocations" << std::setw(16) << "reallocations" <<
+      std::setw(14) << "copies" << std::setw(16) << "bytes copied" <<
+      std::endl;
+  ThreadStats total{0, 0, 0, 0, 0};
+  for (int tid = 0; tid < get_max_slots(); ++tid) {
+    auto& stats = thread_stats(tid);
+    if (stats.nallocations > 0 || stats.ndeallocations > 0) {
+      out << std::setw(12) << tid << std::setw(16) << stats.nallocations <<
+          std::setw(16) << stats.ndeallocations << std::setw(16) <<
+          stats.nreallocations << std::setw(14) << stats.ncopies <<
+          std::setw(16) << stats.ncopied << std::endl;
+    }
+    total.nallocations += stats.nallocations;
+    total.ndeallocations += stats.ndeallocations;
+    total.nreallocations += stats.nreallocations;
+    total.ncopies += stats.ncopies;
+    total.ncopied += stats.ncopied;
+  }
+  out << std::setw(12) << "total" << std::setw(16) << total.nallocations <<
+      std::setw(16) << total.ndeallocations << std::setw(16) <<
+      total.nreallocations << std::setw(14) << total.ncopies <<
+      std::setw(16) << total.ncopied << std::endl << std::endl;
+
+  /* blocks by size class */
+  out << std::setw(12) << "size class" << std::setw(14) << "live blocks" <<
+      std::setw(16) << "requested" << std::setw(16) << "allocated" <<
+      std::setw(10) << "internal" << std::setw(16) << "cached free" <<
+      std::endl;
+  int64_t totalRequested = 0, totalAllocated = 0, totalCached = 0;
+  for (int i = 0; i < NCLASSES; ++i) {
+    BinStats stats{0, 0, 0};
+    for (int tid = 0; tid < get_max_slots(); ++tid) {
+      auto& s = bin_stats(tid, i);
+      stats.nlive += s.nlive;
+      stats.nrequested += s.nrequested;
+      stats.ncarved += s.ncarved;
+    }
+    if (stats.nlive > 0 || stats.ncarved > 0) {
+      int64_t size = unbin(i);
+      int64_t allocated = stats.nlive*size;
+      int64_t cached = std::max(stats.ncarved - stats.nlive, int64_t(0))*size;
+      double internal = allocated > 0 ?
+          100.0*(allocated - stats.nrequested)/allocated : 0.0;
+      out << std::setw(12) << size << std::setw(14) << stats.nlive <<
+          std::setw(16) << stats.nrequested << std::setw(16) << allocated <<
+          std::setw(9) << std::fixed << std::setprecision(1) << internal <<
+          '%' << std::setw(16) << cached << std::endl;
+      totalRequested += stats.nrequested;
+      totalAllocated += allocated;
+      totalCached += cached;
+    }
+  }
+  double internal = totalAllocated > 0 ?
+      100.0*(totalAllocated - totalRequested)/totalAllocated : 0.0;
+  out << std::setw(12) << "total" << std::setw(14) << "" << std::setw(16) <<
+      totalRequested << std::setw(16) << totalAllocated << std::setw(9) <<
+      std::fixed << std::setprecision(1) << internal << '%' <<
+      std::setw(16) << totalCached << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+
+  /* live objects by class, most numerous first */
+  if (memory_stats) {
+    std::map<std::string,int64_t> merged;
+    for (int tid = 0; tid < get_max_slots(); ++tid) {
+      for (auto& entry : object_counts(tid)) {
+        merged[entry.first] += entry.second;
+      }
+    }
+    std::vector<std::pair<std::string,int64_t>> counts(merged.begin(),
+        merged.end());
+    std::stable_sort(counts.begin(), counts.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    out << std::endl << std::setw(32) << "class" << std::setw(14) <<
+        "live objects" << std::endl;
+    for (auto& entry : counts) {
+      if (entry.second > 0) {
+        out << std::setw(32) << entry.first << std::setw(14) << entry.second <<
+            std::endl;
+      }
+    }
+  }
+  #else
+  out << "memory statistics are not available; configure LibBirch with " <<
+      "--enable-memory-stats to enable them." << std::endl;
+  #endif
+}
+
 void libbirch::register_possible_root(Any* o) {
   assert(o);
   o->incMemo();
-  get_thread_possible_roots().emplace_back(o);
+  auto& possible_roots = get_thread_possible_roots();
+  if (!collecting.load(std::memory_order_relaxed)) {
+    make_room(possible_roots);
+  }
+  possible_roots.emplace_back(o);
+  if (collect_auto.load(std::memory_order_relaxed) &&
+      possible_roots.size() >=
+      collect_roots.load(std::memory_order_relaxed)/get_max_threads()) {
+    collect_due.store(true, std::memory_order_relaxed);
+  }
+}
+
+void libbirch::register_merge(Any* o, const int tid) {
+  assert(o);
+  o->incMemo();
+  auto& merges = get_merges(tid);
+  merges.lock.set();
+  merges.objects.emplace_back(o);
+  merges.lock.unset();
+}
+
+void libbirch::merge_counts() {
+  /* while the background thread destroys the unreachable objects of the
+   * last collection, some of these may be registered; leave them for the
+   * next collection, which first waits for it */
+  if (!in_parallel() && !sweeper().thread.joinable()) {
+    for (int i = 0; i < get_max_threads(); ++i) {
+      merge_registered(i);
+    }
+  }
+}
+
+void libbirch::register_tenured(Any* o) {
+  assert(o);
+  o->incMemo();
+  get_promotions(get_thread_num()).emplace_back(o);
 }
 
 void libbirch::register_unreachable(Any* o) {
@@ -196,62 +1339,404 @@ void libbirch::register_unreachable(Any* o) {
   get_thread_unreachable().emplace_back(o);
 }
 
+void libbirch::register_visit(Any* o, const Visit visit) {
+  static_assert(alignof(Any) >= 4, "visit operation does not fit in address");
+  auto& f = get_frontier(get_thread_num());
+  f.visits.push_back(reinterpret_cast<uintptr_t>(o) | uintptr_t(visit));
+  if (f.visits.size() >= 2*VISIT_CHUNK) {
+    /* move the older chunk to the deque, where it may be stolen */
+    visit_list chunk(f.visits.begin(), f.visits.begin() + VISIT_CHUNK);
+    f.visits.erase(f.visits.begin(), f.visits.begin() + VISIT_CHUNK);
+    f.lock.set();
+    f.chunks.emplace_back(std::move(chunk));
+    f.lock.unset();
+  }
+}
+
+/**
+ * Body of the background thread of the cycle collector.
+ *
+ * @param slot Thread slot.
+ */
+static void sweep(const int slot) {
+  using clock = std::chrono::steady_clock;
+  libbirch::thread_slot = slot;
+  auto& s = sweeper();
+  auto& stats = collector_thread_stats(slot);
+  std::unique_lock<std::mutex> guard(s.mutex);
+  while (true) {
+    s.changed.wait(guard, [&s]() { return s.pending || s.stop; });
+    if (!s.pending) {
+      return;
+    }
+    guard.unlock();
+    auto start = clock::now();
+    for (int tid = 0; tid < slot; ++tid) {
+      auto& unreachable = get_unreachable(tid);
+      for (auto& o : unreachable) {
+        o->destroy();
+        o->decMemo();  // removes last memo count
+      }
+      unreachable.clear();
+    }
+    stats.sweep += std::chrono::duration<double>(clock::now() -
+        start).count();
+    guard.lock();
+    s.pending = false;
+    s.changed.notify_all();
+  }
+}
+
+/**
+ * Wait for any pending sweep of the background thread to finish.
+ */
+static void wait_sweep() {
+  auto& s = sweeper();
+  std::unique_lock<std::mutex> guard(s.mutex);
+  s.changed.wait(guard, [&s]() { return !s.pending; });
+}
+
+/**
+ * Stop the background thread, after any pending sweep.
+ */
+static void stop_sweep() {
+  auto& s = sweeper();
+  {
+    std::lock_guard<std::mutex> guard(s.mutex);
+    s.stop = true;
+    s.changed.notify_all();
+  }
+  s.thread.join();
+}
+
+void libbirch::set_collect_concurrent(const bool enable) {
+  auto& s = sweeper();
+  if (enable && !s.thread.joinable()) {
+    /* construct the lists used by the thread before registering the exit
+     * handler, so that they are destroyed after it has stopped */
+    get_unreachable(0);
+    get_possible_roots(0);
+    s.thread = std::thread(sweep, get_max_threads());
+    std::atexit(stop_sweep);
+  } else if (!enable) {
+    wait_sweep();
+  }
+  collect_concurrent = enable;
+}
+
+void libbirch::set_collect_slice_budget(const double budget) {
+  collect_slice_budget = std::max(budget, 0.0);
+}
+
+void libbirch::set_collect_generational(const bool enable) {
+  collect_generational = enable;
+  nminor = 0;
+}
+
+void libbirch::set_collect_auto(const bool enable) {
+  collect_auto.store(enable, std::memory_order_relaxed);
+  if (!enable) {
+    collect_due.store(false, std::memory_order_relaxed);
+  }
+}
+
 void libbirch::collect() {
+  using clock = std::chrono::steady_clock;
+  auto& stats = collector_stats();
+  auto start = clock::now();
+  auto lap = start;
+
+  /* wait for the background thread to finish destroying the unreachable
+   * objects of the previous collection, then take over any possible roots
+   * that it registered in doing so */
+  if (sweeper().thread.joinable()) {
+    wait_sweep();
+    auto& from = get_possible_roots(get_max_threads());
+    auto& to = get_thread_possible_roots();
+    to.insert(to.end(), from.begin(), from.end());
+    from.clear();
+  }
+  collecting.store(true, std::memory_order_relaxed);
+
+  /* decide whether this is a minor or full collection */
+  collect_minor = collect_generational && nminor + 1 < COLLECT_FULL_PERIOD;
+  if (collect_minor) {
+    ++nminor;
+  } else {
+    nminor = 0;
+    ++stats.nfull;
+  }
+
+  /* elapsed time since the last lap, updating the lap */
+  auto elapsed = [&lap]() {
+    auto now = clock::now();
+    auto result = std::chrono::duration<double>(now - lap).count();
+    lap = now;
+    return result;
+  };
+
+  /* number of possible roots remaining to be processed across all threads,
+   * and whether to proceed with another slice */
+  Atomic<int64_t> remaining(0);
+  int64_t nroots = 0;
+  bool proceed = true;
+
+  /* number of objects destroyed */
+  Atomic<int64_t> ndestroyed(0);
+  collect_due.store(false, std::memory_order_relaxed);
+
+  /* number of threads with visits to perform in the current phase; each
+   * phase starts with all threads out of work, so that visits from the
+   * possible roots are registered, to be shared */
+  Atomic<int> nbusy(0);
+  hungry.store(get_max_threads() > 1, std::memory_order_relaxed);
+
   #pragma omp parallel num_threads(get_max_threads())
   {
-    /* mark */
+    auto tid = get_thread_num();
+
+    /* merge biased counts of objects released by other threads */
+    merge_registered(tid);
+    #pragma omp barrier
+    #pragma omp master
+    stats.merge += elapsed();
+
+    /* a full collection also processes the possible roots in the old
+     * generation set aside by minor collections */
+    if (!collect_minor) {
+      auto& tenured = get_tenured(tid);
+      auto& possible_roots = get_thread_possible_roots();
+      possible_roots.insert(possible_roots.end(), tenured.begin(),
+          tenured.end());
+      tenured.clear();
+    }
+
+    /* the possible roots registered up to this point are processed, in
+     * slices if there is a slice budget, otherwise all at once; any
+     * registered while destroying objects are left for the next collection,
+     * as are any remaining when the budget is exhausted */
     auto& possible_roots = get_thread_possible_roots();
-    for (auto& o : possible_roots) {
-      if (o) {
-        if (o->isPossibleRoot()) {
-          o->mark();
-        } else {
+    size_t first = 0;
+    size_t last = possible_roots.size();
+    size_t slice = collect_slice_budget > 0.0 ? COLLECT_SLICE : last;
+    remaining.add(int64_t(last));
+    #pragma omp barrier
+    #pragma omp master
+    nroots = remaining.load();
+
+    /* in each phase below, operations on the possible roots push visits
+     * to the members of objects onto the frontier of the thread, which are
+     * then drained by all threads, with work stealing, so that the work of
+     * the phase is balanced across threads regardless of which thread
+     * registered the possible roots */
+    while (proceed) {
+      auto end = std::min(first + slice, last);
+      collector_thread_stats(tid).nroots += end - first;
+
+      /* mark */
+      for (auto i = first; i < end; ++i) {
+        auto& o = possible_roots[i];
+        if (o) {
+          if (o->isPossibleRoot() && o->isSkipped()) {
+            /* set aside in the old generation */
+            auto& tenured = get_tenured(tid);
+            make_room(tenured);
+            tenured.emplace_back(o);
+            o = nullptr;
+          } else if (o->isPossibleRoot()) {
+            o->mark();
+          } else {
+            o->decMemo();
+            o = nullptr;
+          }
+        }
+      }
+      nbusy.increment();
+      #pragma omp barrier
+      drain(nbusy);
+      #pragma omp barrier
+      #pragma omp master
+      stats.mark += elapsed();
+
+      /* scan */
+      for (auto i = first; i < end; ++i) {
+        auto& o = possible_roots[i];
+        if (o) {
+          o->scan();
+        }
+      }
+      nbusy.increment();
+      #pragma omp barrier
+      drain(nbusy);
+      #pragma omp barrier
+      #pragma omp master
+      stats.scan += elapsed();
+
+      /* collect */
+      for (auto i = first; i < end; ++i) {
+        auto& o = possible_roots[i];
+        if (o) {
+          o->collect();
           o->decMemo();
           o = nullptr;
         }
       }
-    }
-    #pragma omp barrier
+      remaining.subtract(int64_t(end - first));
+      nbusy.increment();
+      #pragma omp barrier
+      drain(nbusy);
+      #pragma omp barrier
+      #pragma omp master
+      stats.collect += elapsed();
 
-    /* scan */
-    for (auto& o : possible_roots) {
-      if (o) {
-        o->scan();
+      /* destroy the objects indicated during collect, unless in concurrent
+       * mode, where that is left to the background thread */
+      auto& unreachable = get_thread_unreachable();
+      if (!collect_concurrent) {
+        for (auto& o : unreachable) {
+          o->destroy();
+          o->decMemo();  // removes last memo count
+        }
+        ndestroyed.add(int64_t(unreachable.size()));
+        unreachable.clear();
       }
-    }
-    #pragma omp barrier
+      first = end;
+      #pragma omp barrier
 
-    /* collect */
-    for (auto& o : possible_roots) {
-      if (o) {
-        o->collect();
-        o->decMemo();
-        o = nullptr;
+      /* decide whether to proceed with another slice */
+      #pragma omp master
+      {
+        stats.destroy += elapsed();
+        ++stats.nslices;
+        auto budget = std::chrono::duration<double>(collect_slice_budget);
+        proceed = remaining.load() > 0 && (collect_slice_budget == 0.0 ||
+            clock::now() - start < budget);
       }
+      #pragma omp barrier
+    }
+
+    /* remove processed possible roots, keeping those deferred and those
+     * registered since */
+    possible_roots.erase(possible_roots.begin(),
+        possible_roots.begin() + first);
+
+    /* promote the objects registered for promotion; this is left until now
+     * so that the old generation is the same throughout the collection */
+    auto& promotions = get_promotions(tid);
+    for (auto& o : promotions) {
+      o->tenure();
+      o->decMemo();
     }
-    possible_roots.clear();
+    promotions.clear();
+
+    #if defined(ENABLE_MEMORY_RECLAIM) && !defined(DISABLE_MEMORY_POOL)
+    /* return free memory to the operating system */
+    #pragma omp barrier
+    #pragma omp master
+    elapsed();
+    reclaim();
     #pragma omp barrier
+    #pragma omp master
+    stats.reclaim += elapsed();
+    #endif
+  }
+
+  hungry.store(false, std::memory_order_relaxed);
+  collecting.store(false, std::memory_order_relaxed);
 
-    /* destroy the objects indicated during collect */
-    auto& unreachable = get_thread_unreachable();
-    for (auto& o : unreachable) {
-      o->destroy();
-      o->decMemo();  // removes last memo count
+  /* in concurrent mode, hand the unreachable objects to the background
+   * thread */
+  if (collect_concurrent) {
+    for (int tid = 0; tid < get_max_threads(); ++tid) {
+      ndestroyed.add(int64_t(get_unreachable(tid).size()));
+    }
+    if (ndestroyed.load() > 0) {
+      auto& s = sweeper();
+      std::lock_guard<std::mutex> guard(s.mutex);
+      s.pending = true;
+      s.changed.notify_all();
     }
+  }
+
+  auto total = std::chrono::duration<double>(clock::now() - start).count();
+  auto deferred = remaining.load();
+  ++stats.ncollections;
+  stats.nroots += nroots - deferred;
+  stats.ndeferred += deferred;
+  stats.ndestroyed += ndestroyed.load();
 
-    unreachable.clear();
+  /* adapt the thresholds for automatic collection */
+  auto roots = collect_roots.load(std::memory_order_relaxed);
+  if (8*ndestroyed.load() < nroots - deferred) {
+    roots = 2*roots;
+  } else {
+    roots = std::max(roots/2, MIN_COLLECT_ROOTS);
   }
+  collect_roots.store(roots, std::memory_order_relaxed);
+  #ifndef DISABLE_MEMORY_POOL
+  size_t heap = 0;
+  for (int tid = 0; tid < get_max_slots(); ++tid) {
+    heap += arena(tid).nchunks*CHUNK_SIZE;
+    arena(tid).ngrown = 0;
+  }
+  collect_bytes.store(std::max(heap, MIN_COLLECT_BYTES),
+      std::memory_order_relaxed);
+  #endif
+  stats.total += total;
+  stats.max = std::max(stats.max, total);
 }
 
-void libbirch::trim(Any* o) {
-  auto& possible_roots = get_thread_possible_roots();
-  while (!possible_roots.empty()) {
-    auto ptr = possible_roots.back();
-    if (ptr == o || !ptr->isPossibleRoot()) {
-      possible_roots.pop_back();
-      ptr->decMemo();
-    } else {
-      return;
-    }
+void libbirch::collector_report(std::ostream& out) {
+  /* wait for any sweep in progress, so that its time can be read */
+  if (sweeper().thread.joinable()) {
+    wait_sweep();
+  }
+  auto& stats = collector_stats();
+  auto sweep = collector_thread_stats(get_max_threads()).sweep;
+  auto flags = out.flags();
+  auto precision = out.precision();
+
+  out << "collections " << stats.ncollections << " (" << stats.nfull <<
+      " full), slices " << stats.nslices << ", possible roots processed " <<
+      stats.nroots << ", deferred " << stats.ndeferred <<
+      ", objects destroyed " << stats.ndestroyed << std::endl;
+  out << std::fixed << std::setprecision(6);
+  out << std::setw(12) << "phase" << std::setw(14) << "seconds" <<
+      std::endl;
+  out << std::setw(12) << "merge" << std::setw(14) << stats.merge <<
+      std::endl;
+  out << std::setw(12) << "mark" << std::setw(14) << stats.mark << std::endl;
+  out << std::setw(12) << "scan" << std::setw(14) << stats.scan << std::endl;
+  out << std::setw(12) << "collect" << std::setw(14) << stats.collect <<
+      std::endl;
+  out << std::setw(12) << "destroy" << std::setw(14) << stats.destroy <<
+      std::endl;
+  out << std::setw(12) << "reclaim" << std::setw(14) << stats.reclaim <<
+      std::endl;
+  out << std::setw(12) << "total" << std::setw(14) << stats.total <<
+      std::endl;
+  out << std::setw(12) << "max pause" << std::setw(14) << stats.max <<
+      std::endl;
+  if (sweep > 0.0) {
+    out << std::setw(12) << "background" << std::setw(14) << sweep <<
+        std::endl;
   }
+
+  /* work by thread */
+  out << std::endl << std::setw(12) << "thread" << std::setw(16) <<
+      "possible roots" << std::setw(16) << "frontier" << std::setw(12) <<
+      "steals" << std::endl;
+  for (int tid = 0; tid < get_max_threads(); ++tid) {
+    auto& stats = collector_thread_stats(tid);
+    out << std::setw(12) << tid << std::setw(16) << stats.nroots <<
+        std::setw(16) << stats.nvisits << std::setw(12) << stats.nsteals <<
+        std::endl;
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void libbirch::trim() {
+  assert(!collecting.load(std::memory_order_relaxed));
+  compact(get_thread_possible_roots());
 }
@@ -5,6 +5,7 @@
 
 #include "libbirch/external.hpp"
 #include "libbirch/thread.hpp"
+#include "libbirch/Atomic.hpp"
 #include "libbirch/ExitBarrierLock.hpp"
 
 namespace libbirch {
@@ -26,6 +27,12 @@ extern ExitBarrierLock finish_lock;
  */
 extern ExitBarrierLock freeze_lock;
 
+/**
+ * Are live objects being counted by class? This is off by default, and is
+ * switched on with enable_memory_stats().
+ */
+extern bool memory_stats;
+
 /**
  * Get the root label.
  */
@@ -36,6 +43,11 @@ Label*& root();
  *
  * @param n Number of bytes.
  *
+ * When @p n is a multiple of 64, the memory is aligned to 64 bytes. The pool
+ * gives this without extra work, as each such size is the size of a bin, and
+ * the blocks of a bin are carved from chunks at multiples of it after a
+ * 64-byte header; without the pool, it is requested explicitly.
+ *
  * @return Pointer to the allocated memory.
  */
 void* allocate(const size_t n);
@@ -63,6 +75,43 @@ void deallocate(void* ptr, const size_t n, const int tid);
 void* reallocate(void* ptr1, const size_t n1, const int tid1,
     const size_t n2);
 
+/**
+ * Start counting live objects by class, for memory_report(). Objects created
+ * before this is called are not counted, neither when created nor when
+ * destroyed. This has no effect unless LibBirch is configured with
+ * `--enable-memory-stats`.
+ */
+void enable_memory_stats();
+
+/**
+ * Count objects of a class as created or destroyed. This is called by
+ * objects themselves when memory_stats is set.
+ *
+ * @param name Class name, as returned by Any::getClassName().
+ * @param n Number of objects; positive when created, negative when
+ * destroyed.
+ */
+void count_object(const char* name, const int n);
+
+/**
+ * Write a report of memory use to a stream.
+ *
+ * @param out The stream.
+ *
+ * The report gives, for each thread, the number of allocations,
+ * deallocations and reallocations performed, and the number of those
+ * reallocations that moved to a new block, along with the bytes copied to do
+ * so. For each size class, it then gives the number of blocks in use, the
+ * number of bytes requested for them, the number of bytes allocated for them
+ * (the block size multiplied by the number of blocks), the internal
+ * fragmentation (the proportion of allocated bytes not requested), and the
+ * number of bytes in free blocks held in pools for reuse. Finally, if
+ * enable_memory_stats() has been called, it gives the number of live objects
+ * of each class. The statistics are only collected if LibBirch is configured
+ * with `--enable-memory-stats`.
+ */
+void memory_report(std::ostream& out);
+
 /**
  * Register an object with the cycle collector as the possible root of a
  * cycle. This corresponds to the `PossibleRoot()` operation in @ref Bacon2001
@@ -70,29 +119,234 @@ void* reallocate(void* ptr1, const size_t n1, const int tid1,
  */
 void register_possible_root(Any* o);
 
+/**
+ * Register an object with its owning thread to merge its biased count into
+ * its shared count at the next cycle collection. This is used by threads
+ * other than the owning thread when the shared count of the object reaches
+ * zero or below, such that the total count may be zero.
+ *
+ * Until then, such an object is not destroyed, even if no references to it
+ * remain. This is only the case where the owning thread is running when the
+ * last reference made by another thread is released, i.e. within a parallel
+ * region, or for objects owned by the master thread or the background
+ * thread of the collector. Where the master thread releases, outside of any
+ * parallel region, the last reference to an object owned by another thread
+ * of the team, that thread is idle, and the master merges the count itself,
+ * destroying the object immediately. Objects registered within a parallel
+ * region are merged by merge_counts() at its end, or otherwise at the next
+ * collection; a program that uses parallel regions of its own, rather than
+ * those generated for `parallel for`, should call one or the other.
+ *
+ * @param o The object.
+ * @param tid Id of the owning thread.
+ */
+void register_merge(Any* o, const int tid);
+
+/**
+ * Merge the biased counts of all objects registered with register_merge(),
+ * on behalf of their owning threads. This is called by the master thread
+ * outside of any parallel region, when the other threads of the team are
+ * idle, and does nothing if called within one, e.g. at the end of a nested
+ * parallel region. Calls to this are generated at the end of each
+ * `parallel for`.
+ *
+ * Objects with no references left are destroyed. The others are then
+ * merged, so that the release of their last reference destroys them
+ * immediately, whichever thread releases it. This is skipped while the
+ * background thread of the collector is destroying objects (see
+ * set_collect_concurrent()); the next collection merges them instead.
+ */
+void merge_counts();
+
 /**
  * Register an object with the cycle collector as unreachable.
  */
 void register_unreachable(Any* o);
 
+/**
+ * Register an object with the cycle collector for promotion to the old
+ * generation at the end of the current collection.
+ */
+void register_tenured(Any* o);
+
+/**
+ * Is generational collection enabled? See set_collect_generational().
+ */
+extern bool collect_generational;
+
+/**
+ * Is the cycle collection in progress a minor one? See
+ * set_collect_generational().
+ */
+extern bool collect_minor;
+
+/**
+ * Operation of the cycle collector on the members of an object.
+ */
+enum Visit : unsigned {
+  MARK_MEMBERS = 0u,
+  SCAN_MEMBERS = 1u,
+  REACH_MEMBERS = 2u,
+  COLLECT_MEMBERS = 3u
+};
+
+/**
+ * Register an object with the cycle collector to visit its members. The
+ * visit is pushed onto the frontier of the current thread, from which it may
+ * be stolen by another thread, and is performed before the current phase of
+ * collection ends.
+ *
+ * @param o The object.
+ * @param visit The operation.
+ */
+void register_visit(Any* o, const Visit visit);
+
+/**
+ * Is any thread of the cycle collector out of visits to perform? While not,
+ * objects visit their members immediately, by recursion, which is cheaper
+ * than registering the visits; while so, they register them, so that they
+ * may be stolen.
+ */
+extern Atomic<bool> hungry;
+
 /**
  * Run the cycle collector.
+ *
+ * If a slice budget has been set with set_collect_slice_budget(), the
+ * possible roots are processed in slices, and no further slice is started
+ * once the budget is exhausted, leaving the remaining possible roots for the
+ * next call. Otherwise all possible roots are processed.
+ *
+ * If generational collection has been enabled with
+ * set_collect_generational(), most collections are minor ones, which do not
+ * traverse the old generation; see that function.
+ *
+ * If LibBirch is configured with `--enable-reclaim`, this also returns to the
+ * operating system any chunks of the heap in which all blocks are free, so
+ * that resident memory follows the size of the live set rather than its
+ * historical peak.
  */
 void collect();
 
+/**
+ * Set the slice budget for cycle collection: the time after which a
+ * collection starts no further slice of possible roots.
+ *
+ * @param budget Budget, in seconds. Zero, the default, for no budget.
+ *
+ * This is not a bound on the pause. Each slice processes a bounded number of
+ * possible roots per thread, but a slice, once started, runs to completion,
+ * as the trial deletion of a cycle cannot be abandoned part way; it may take
+ * arbitrarily long if those roots reach a large graph of objects. The pause
+ * is therefore the budget plus the duration of the last slice.
+ */
+void set_collect_slice_budget(const double budget);
+
+/**
+ * Enable or disable concurrent mode for the cycle collector. It is disabled
+ * by default.
+ *
+ * @param enable Enable?
+ *
+ * In concurrent mode, collect() identifies unreachable objects as usual,
+ * with the mutator paused, but then hands them to a background thread to
+ * destroy, and returns. The mutator continues meanwhile. The next call to
+ * collect() waits for the background thread to finish first. Disabling
+ * concurrent mode also waits for it.
+ *
+ * Only the destruction of unreachable objects is concurrent. Identifying
+ * them, by marking and scanning from the possible roots, still stops the
+ * world, so that concurrent mode shortens pauses by the time to destroy
+ * objects, not the time to find them.
+ */
+void set_collect_concurrent(const bool enable);
+
+/**
+ * Enable or disable generational cycle collection. It is disabled by
+ * default.
+ *
+ * @param enable Enable?
+ *
+ * While enabled, a frozen object that is found reachable by two cycle
+ * collections is promoted to the old generation. Frozen objects are
+ * typically shared between many clones, such as model parameters cloned
+ * from an archetype, and live long. Only every eighth collection is a full
+ * one; the rest are minor collections, which treat objects in the old
+ * generation as reachable, and do not traverse them. Possible roots in the
+ * old generation are set aside until the next full collection. The cost of
+ * a minor collection then scales with the objects that are young or
+ * recently mutated, rather than with the whole heap, while garbage cycles
+ * that pass through the old generation wait for a full collection, and so
+ * hold memory for longer. While disabled, every collection is a full one,
+ * and objects are not promoted.
+ */
+void set_collect_generational(const bool enable);
+
+/**
+ * Enable or disable automatic cycle collection. It is disabled by default.
+ *
+ * @param enable Enable?
+ *
+ * While enabled, a collection becomes due once the number of possible
+ * roots buffered, or the number of bytes by which the heap has grown since
+ * the last collection, crosses a threshold. Both thresholds adapt: the
+ * former to the yield of previous collections, the latter to the size of
+ * the heap after the last collection. A due collection is run at the next
+ * call to collect_if_due().
+ *
+ * As such calls are generated in every loop, the collection may then stop
+ * the world at any loop iteration outside a parallel region, including in
+ * code run while constructing an object that is not yet referenced. This
+ * is opt-in for that reason; while disabled, collect_if_due() reduces to a
+ * relaxed load of a flag that is never set.
+ */
+void set_collect_auto(const bool enable);
+
+/**
+ * Is a cycle collection due? See set_collect_auto().
+ */
+extern Atomic<bool> collect_due;
+
+/**
+ * Run the cycle collector if a collection is due, and the calling thread is
+ * not within a parallel region. Calls to this are generated at the start of
+ * the body of each `for`, `while` and `do-while` loop (but not `parallel
+ * for`), where the temporaries of the previous iteration are no longer
+ * alive, so that programs need not call collect() explicitly.
+ */
+inline void collect_if_due() {
+  if (collect_due.load(std::memory_order_relaxed) && !in_parallel()) {
+    collect();
+  }
+}
+
+/**
+ * Write a report of cycle collector statistics to a stream.
+ *
+ * @param out The stream.
+ *
+ * The report gives the number of collections, and of those how many were
+ * full, then the number of slices processed within them, of possible roots
+ * processed and deferred, and of objects destroyed, followed by the time
+ * spent in each phase of collection, the total time, the longest single
+ * pause and, in concurrent mode, the time spent by the background thread.
+ * Finally, for each thread, it gives the number of possible roots
+ * processed, visits to the members of objects performed from the frontier,
+ * and chunks of visits stolen from other threads.
+ */
+void collector_report(std::ostream& out);
+
 /**
  * Performs some maintenance operations on the current thread's set of
  * registered possible roots.
  *
- * @param o The object that called this operation, and that is not a possible
- * root.
- *
- * Specifically, from the back of the vector of possible roots, this removes
- * any pointers to objects that are (no longer) possible roots, either because
- * they are flagged as such, or because they match `o`. Working from the back
- * is a reasonable heuristic, especially for pointers on the stack, which
- * a destroyed in the reverse order in which they are created.
+ * Specifically, this compacts the vector of possible roots, removing any
+ * pointers to objects that are no longer possible roots, such as those
+ * destroyed since they were registered, and releasing the memo counts that
+ * keep their memory allocated. This is performed automatically whenever the
+ * vector would otherwise grow, but may also be triggered explicitly. It
+ * must not be called during a cycle collection.
  */
-void trim(Any* o);
+void trim();
 
 }
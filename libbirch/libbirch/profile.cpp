@@ -0,0 +1,109 @@
+/**
+ * @file
+ */
+#include "libbirch/profile.hpp"
+
+#include "libbirch/memory.hpp"
+
+#include <chrono>
+
+#ifdef ENABLE_PROFILE
+/**
+ * Tick count at which profiling was enabled.
+ */
+static int64_t start_ticks = 0;
+
+/**
+ * Time at which profiling was enabled. Together with start_ticks, this is
+ * used to convert ticks to seconds.
+ */
+static std::chrono::steady_clock::time_point start_time;
+#endif
+
+bool libbirch::profiling = false;
+
+libbirch::ProfileStats& libbirch::profile_stats(const int tid) {
+  static ProfileStats* stats = new ProfileStats[get_max_slots()]();
+  return stats[tid];
+}
+
+void libbirch::enable_profile() {
+  #ifdef ENABLE_PROFILE
+  start_ticks = profile_ticks();
+  start_time = std::chrono::steady_clock::now();
+  profiling = true;
+  #endif
+}
+
+void libbirch::profile_report(std::ostream& out) {
+  #ifdef ENABLE_PROFILE
+  if (profiling) {
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    /* sum over threads */
+    ProfileStats total{};
+    for (int tid = 0; tid < get_max_slots(); ++tid) {
+      auto& stats = profile_stats(tid);
+      for (unsigned i = 0; i < NCOUNTERS; ++i) {
+        total.counts[i] += stats.counts[i];
+      }
+      for (unsigned i = 0; i < NTIMERS; ++i) {
+        total.calls[i] += stats.calls[i];
+        total.ticks[i] += stats.ticks[i];
+      }
+    }
+
+    /* seconds per tick, and elapsed seconds, since profiling was enabled */
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time).count();
+    auto ticks = profile_ticks() - start_ticks;
+    double seconds = ticks > 0 ? elapsed/ticks : 0.0;
+
+    /* counts */
+    static const char* counters[NCOUNTERS] = { "copies", "recycles",
+        "memo hits", "memo misses", "finished", "frozen", "destroyed" };
+    out << std::setw(12) << "event" << std::setw(16) << "count" << std::endl;
+    for (unsigned i = 0; i < NCOUNTERS; ++i) {
+      out << std::setw(12) << counters[i] << std::setw(16) <<
+          total.counts[i] << std::endl;
+    }
+    auto nclones = total.calls[TIME_CLONE];
+    if (nclones > 0) {
+      out << std::fixed << std::setprecision(1);
+      out << std::setw(12) << "finished" << std::setw(16) <<
+          double(total.counts[COUNT_FINISHED])/nclones << " per clone" <<
+          std::endl;
+      out << std::setw(12) << "frozen" << std::setw(16) <<
+          double(total.counts[COUNT_FROZEN])/nclones << " per clone" <<
+          std::endl;
+    }
+    out << std::endl;
+
+    /* times */
+    static const char* timers[NTIMERS] = { "clone", "finish", "freeze",
+        "map get", "map pull", "map copy", "compact" };
+    out << std::setw(12) << "operation" << std::setw(16) << "calls" <<
+        std::setw(14) << "seconds" << std::setw(14) << "mean ticks" <<
+        std::setw(10) << "time" << std::endl;
+    for (unsigned i = 0; i < NTIMERS; ++i) {
+      auto calls = total.calls[i];
+      double secs = total.ticks[i]*seconds;
+      double mean = calls > 0 ? double(total.ticks[i])/calls : 0.0;
+      double percent = elapsed > 0.0 ? 100.0*secs/elapsed : 0.0;
+      out << std::setw(12) << timers[i] << std::setw(16) << calls <<
+          std::setw(14) << std::setprecision(6) << secs << std::setw(14) <<
+          std::setprecision(1) << mean << std::setw(9) << percent << '%' <<
+          std::endl;
+    }
+    out << std::setw(12) << "elapsed" << std::setw(30) <<
+        std::setprecision(6) << elapsed << std::endl << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+  #else
+  out << "profiling is not available; configure LibBirch with " <<
+      "--enable-profile to enable it." << std::endl << std::endl;
+  #endif
+  collector_report(out);
+}
@@ -0,0 +1,229 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "libbirch/external.hpp"
+#include "libbirch/thread.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace libbirch {
+/**
+ * Is profiling of lazy copy operations on? This is off by default, and is
+ * switched on with enable_profile().
+ */
+extern bool profiling;
+
+/**
+ * Event counted when profiling.
+ */
+enum ProfileCounter : unsigned {
+  /**
+   * Objects copied, on write or on clone.
+   */
+  COUNT_COPIES = 0u,
+
+  /**
+   * Objects recycled in place of a copy, as the last reference to them was
+   * being updated.
+   */
+  COUNT_RECYCLES,
+
+  /**
+   * Lookups of frozen objects in a memo that found a mapping.
+   */
+  COUNT_MEMO_HITS,
+
+  /**
+   * Lookups of frozen objects in a memo that found none.
+   */
+  COUNT_MEMO_MISSES,
+
+  /**
+   * Objects finished, i.e. visited by the first traversal of clone().
+   */
+  COUNT_FINISHED,
+
+  /**
+   * Objects frozen, i.e. visited by the second traversal of clone().
+   */
+  COUNT_FROZEN,
+
+  /**
+   * Objects destroyed, whether by reference count or by the cycle
+   * collector.
+   */
+  COUNT_DESTROYED,
+
+  /**
+   * Number of counters.
+   */
+  NCOUNTERS
+};
+
+/**
+ * Operation timed when profiling. Times are inclusive: e.g. that of the
+ * finish traversal of clone() includes that of the mapGet() operations it
+ * performs.
+ */
+enum ProfileTimer : unsigned {
+  /**
+   * Deep clones, i.e. calls to clone().
+   */
+  TIME_CLONE = 0u,
+
+  /**
+   * Finish traversals within clone().
+   */
+  TIME_FINISH,
+
+  /**
+   * Freeze traversals within clone().
+   */
+  TIME_FREEZE,
+
+  /**
+   * Label::mapGet(), mapping an object for writing.
+   */
+  TIME_MAP_GET,
+
+  /**
+   * Label::mapPull(), mapping an object for reading.
+   */
+  TIME_MAP_PULL,
+
+  /**
+   * Label::mapCopy(), copying an object as the first step of a clone.
+   */
+  TIME_MAP_COPY,
+
+  /**
+   * Compaction of memos.
+   */
+  TIME_COMPACT,
+
+  /**
+   * Number of timers.
+   */
+  NTIMERS
+};
+
+/**
+ * Profile of a thread. Each thread updates its own without atomics.
+ */
+struct ProfileStats {
+  /**
+   * Counts, indexed by ProfileCounter.
+   */
+  int64_t counts[NCOUNTERS];
+
+  /**
+   * Number of timed operations, indexed by ProfileTimer.
+   */
+  int64_t calls[NTIMERS];
+
+  /**
+   * Ticks spent in timed operations, indexed by ProfileTimer.
+   */
+  int64_t ticks[NTIMERS];
+};
+
+/**
+ * Get the profile of a thread.
+ *
+ * @param tid Thread number.
+ */
+ProfileStats& profile_stats(const int tid);
+
+/**
+ * Read the tick counter used to time operations. This is the time stamp
+ * counter where available, otherwise a steady clock in nanoseconds.
+ */
+inline int64_t profile_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return int64_t(__rdtsc());
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Count events, if profiling.
+ *
+ * @param counter The counter.
+ * @param n Number of events.
+ */
+inline void profile_count(const ProfileCounter counter, const int64_t n = 1) {
+  if (profiling) {
+    profile_stats(get_thread_num()).counts[counter] += n;
+  }
+}
+
+/**
+ * Times the operation in the scope of the object, if profiling.
+ *
+ * @ingroup libbirch
+ */
+class ProfileScope {
+public:
+  /**
+   * Constructor.
+   *
+   * @param timer The timer.
+   */
+  ProfileScope(const ProfileTimer timer) :
+      timer(timer),
+      start(profiling ? profile_ticks() : 0) {
+    //
+  }
+
+  /**
+   * Destructor.
+   */
+  ~ProfileScope() {
+    if (start) {
+      auto& stats = profile_stats(get_thread_num());
+      ++stats.calls[timer];
+      stats.ticks[timer] += profile_ticks() - start;
+    }
+  }
+
+private:
+  /**
+   * Timer.
+   */
+  ProfileTimer timer;
+
+  /**
+   * Tick count at the start of the operation, or zero if not profiling.
+   */
+  int64_t start;
+};
+
+/**
+ * Start profiling lazy copy operations, for profile_report(). This has no
+ * effect unless LibBirch is configured with `--enable-profile`.
+ */
+void enable_profile();
+
+/**
+ * Write a profile report to a stream.
+ *
+ * @param out The stream.
+ *
+ * The report gives, summed over threads, the number of each event counted
+ * and, for each timed operation, the number of calls, the total and mean
+ * time, and the proportion of the time since enable_profile() was called.
+ * This is followed by a report of the cycle collector, including the time
+ * spent in each of its phases and the number of objects it destroyed (see
+ * collector_report()).
+ */
+void profile_report(std::ostream& out);
+
+}
@@ -20,7 +20,7 @@ struct stack_frame {
 static auto& get_thread_stack_trace() {
   using stack_trace = std::vector<stack_frame,libbirch::Allocator<stack_frame>>;
   static std::vector<stack_trace,libbirch::Allocator<stack_trace>> stack_traces(
-      libbirch::get_max_threads());
+      libbirch::get_max_slots());
   return stack_traces[libbirch::get_thread_num()];
 }
 
@@ -21,11 +21,49 @@ inline int get_max_threads() {
 }
 
 /**
- * Get the current thread's number.
+ * Get the number of thread slots. Per-thread data is kept for each OpenMP
+ * thread, and for one more: the background thread of the cycle collector,
+ * which takes the last slot (see set_collect_concurrent()).
+ *
+ * @ingroup libbirch
+ */
+inline int get_max_slots() {
+  return get_max_threads() + 1;
+}
+
+/**
+ * Slot of the current thread, where it is a thread of LibBirch itself rather
+ * than of OpenMP, otherwise -1.
+ *
+ * @ingroup libbirch
+ */
+extern __thread int thread_slot __attribute__((tls_model("initial-exec")));
+
+/**
+ * Is the current thread within a parallel region?
+ *
+ * @ingroup libbirch
+ */
+inline bool in_parallel() {
+#ifdef _OPENMP
+  return omp_in_parallel();
+#else
+  return false;
+#endif
+}
+
+/**
+ * Get the current thread's number. This is its OpenMP thread number, unless
+ * it is the background thread of the cycle collector, which is numbered
+ * get_max_threads().
  *
  * @ingroup libbirch
  */
 inline int get_thread_num() {
+  auto slot = thread_slot;
+  if (slot >= 0) {
+    return slot;
+  }
 #ifdef _OPENMP
   return omp_get_thread_num();
 #else
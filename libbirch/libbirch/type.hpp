@@ -102,7 +102,12 @@ struct is_acyclic<void,N> {
 /**
  * Is `T` an acyclic class?
  *
- * An acyclic class is a class with all members of acyclic type.
+ * An acyclic class is a class with all members of acyclic type. As every
+ * object has a label, which is not of acyclic type, this is false unless
+ * specialized; the driver specializes it for classes with all other members
+ * of value type, as determined across the whole program, leaving objects
+ * to be linked into cycles through their labels to be handled at run time
+ * (@see Any::setAcyclic()).
  *
  * @seealso is_acyclic
  */